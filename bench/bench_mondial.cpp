@@ -0,0 +1,647 @@
+// benchmark of reading and writing the mondial-3.0.xml file, and of copies of it scaled x10, x100 etc.
+// For each input, the phases are timed separately:
+//     parse:      pugi::xml_document::load_buffer of the xml text
+//     read:       reader deserialization of the parsed document into a world object
+//     build:      writer serialization of the world object into a new document
+//     save:       pugi::xml_document::save of the built document
+//     round_trip: all of the above
+//     read_static, read_from_chars: read with static_reader, or with std::from_chars for numbers
+//     build_static, build_to_chars: build with static_writer, or with std::to_chars for numbers
+//     write_stream: stream_writer serialization into xml text, to compare with build + save
+//     write_countries, write_countries_parallel: the countries written by a stream_writer, on this thread
+//                 or by serialize_container_parallel on a thread_pool
+//     write_binary, read_binary: binary_writer and binary_reader
+//     load_file, load_mapped_file: pugi::xml_document::load_file and pugi_serializer::load_mapped_file of --file
+//     first_answer, first_answer_lazy: read the countries and use one of them, with std::vector<country>
+//                 or with std::vector<pugi_serializer::lazy<country>> which reads only the country that is used
+//     resolve_map, resolve_index: read, and find the countries' capitals and borders by id, with std::map of the
+//                 cities and countries built after reading, or with a pugi_serializer::id_index built while reading
+// and each container type (country, province, city...) is read and written on its own.
+// Per message cost is measured with each country as a message, parsed, read, written and saved again, either with
+// a new document, reader and writer for each message (messages), or with a pugi_serializer::session (messages_session).
+// Instead of the scaled file, documents of given sizes can be generated with --generate, see tests/mondial_generator.hpp.
+// For each phase the peak resident set size and the number of allocations are measured.
+//
+// Output is one line per measurement, as csv (default) or json lines (--json), to be collected over time.
+//
+// usage: bench_mondial [--file tests/mondial-3.0.xml] [--scales 1,10,100] [--generate 10m,100m [--seed 1]] [--iterations 5] [--huge-pages] [--json]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "pugixml.hpp"
+#include "pugi_serializer.hpp"
+#include "mondial_model.hpp"
+#include "mondial_generator.hpp"
+
+// allocation counting: all operator new calls, and pugixml's allocations through set_memory_management_functions
+static std::atomic<size_t> num_allocations{0};
+static std::atomic<size_t> num_allocated_bytes{0};
+
+static void* counted_malloc(size_t _size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    num_allocated_bytes.fetch_add(_size, std::memory_order_relaxed);
+    return std::malloc(_size == 0 ? 1 : _size);
+}
+
+void* operator new(size_t _size)
+{
+    if (void* p = counted_malloc(_size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t _size)
+{
+    return operator new(_size);
+}
+
+void operator delete(void* _p) noexcept { std::free(_p); }
+void operator delete[](void* _p) noexcept { std::free(_p); }
+void operator delete(void* _p, size_t) noexcept { std::free(_p); }
+void operator delete[](void* _p, size_t) noexcept { std::free(_p); }
+
+// peak resident set size in KB. On linux the peak can be reset, so it's measured for each phase,
+// elsewhere it's the peak of the process so far.
+static bool reset_peak_rss()
+{
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    return static_cast<bool>(clear_refs.flush());
+#else
+    return false;
+#endif
+}
+
+static long peak_rss_kb()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (0 == line.compare(0, 6, "VmHWM:"))
+            return std::atol(line.c_str() + 6);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    rusage usage;
+    if (0 == getrusage(RUSAGE_SELF, &usage))
+    {
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+struct measurement
+{
+    std::string input;
+    int scale = 1;
+    std::string phase;
+    std::string container;  // empty for phases of the whole document
+    size_t items = 0;
+    double min_ms = 0.0;
+    double mean_ms = 0.0;
+    long peak_rss_kb = 0;
+    size_t allocations = 0;         // of one iteration
+    size_t allocated_bytes = 0;     // of one iteration
+};
+
+struct options
+{
+    std::string file_name = "tests/mondial-3.0.xml";
+    std::vector<int> scales{1, 10, 100};
+    std::vector<size_t> generated_sizes;    // when not empty, generated documents are used instead of the file
+    uint64_t seed = 1;
+    int iterations = 5;
+    bool huge_pages = false;    // for the session of messages_session
+    bool json = false;
+};
+
+static const unsigned int bench_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+// call _func _iterations times, _func returns the number of items it processed
+template<typename TFunc>
+static measurement measure(const options& _options, const char* _phase, TFunc&& _func)
+{
+    measurement result;
+    result.phase = _phase;
+    reset_peak_rss();
+
+    double total_ms = 0.0;
+    for (int i = 0; i < _options.iterations; ++i)
+    {
+        const size_t allocations_before = num_allocations.load();
+        const size_t bytes_before = num_allocated_bytes.load();
+        auto start = std::chrono::steady_clock::now();
+        result.items = _func();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (0 == i)
+        {
+            result.allocations = num_allocations.load() - allocations_before;
+            result.allocated_bytes = num_allocated_bytes.load() - bytes_before;
+            result.min_ms = elapsed.count();
+        }
+        result.min_ms = std::min(result.min_ms, elapsed.count());
+        total_ms += elapsed.count();
+    }
+    result.mean_ms = total_ms / std::max(_options.iterations, 1);
+    result.peak_rss_kb = peak_rss_kb();
+    return result;
+}
+
+static std::string save_to_string(const pugi::xml_document& _doc)
+{
+    std::ostringstream oss;
+    _doc.save(oss);
+    return oss.str();
+}
+
+// appends saved xml to a string, which keeps its capacity from one message to the next
+struct string_xml_writer : pugi::xml_writer
+{
+    std::string text;
+    void write(const void* _data, size_t _size) override { text.append(static_cast<const char*>(_data), _size); }
+};
+
+// each child of _doc's root named _item_name, as the xml text of its own document
+static std::vector<std::string> item_messages(const pugi::xml_document& _doc, const char* _item_name)
+{
+    std::vector<std::string> messages;
+    for (pugi::xml_node item : _doc.document_element().children(_item_name))
+    {
+        pugi::xml_document message_doc;
+        message_doc.append_copy(item);
+        messages.push_back(save_to_string(message_doc));
+    }
+    return messages;
+}
+
+// the xml text of a document whose root has the children of _doc's root _scale times
+static std::string scaled_text(const pugi::xml_document& _doc, const int _scale)
+{
+    if (1 == _scale)
+        return save_to_string(_doc);
+
+    pugi::xml_document scaled_doc;
+    pugi::xml_node root = scaled_doc.append_child(_doc.document_element().name());
+    for (int i = 0; i < _scale; ++i)
+        for (pugi::xml_node child : _doc.document_element().children())
+            root.append_copy(child);
+    return save_to_string(scaled_doc);
+}
+
+// read the items named _path.back() found by following _path from _ser, e.g. {"country", "province"}
+template<typename TITEM>
+static void read_items(pugi_serializer::serializer_base& _ser, const std::vector<const char*>& _path, const size_t _depth, std::vector<TITEM>& _items)
+{
+    if (_depth + 1 == _path.size())
+    {
+        pugi_serializer::serialize_each<TITEM>(_ser, _path[_depth], [&](TITEM& _item) { _items.push_back(std::move(_item)); });
+        return;
+    }
+    for (auto child_ser = _ser.child(_path[_depth]); child_ser; child_ser = child_ser.next_sibling(_path[_depth]))
+        read_items(child_ser, _path, _depth + 1, _items);
+}
+
+// read and write the items of one container type on their own
+template<typename TITEM>
+static void measure_container(const options& _options, const pugi::xml_document& _doc, const char* _item_name,
+                              const std::vector<std::vector<const char*>>& _paths, std::vector<measurement>& _results)
+{
+    std::vector<TITEM> items;
+    measurement read_result = measure(_options, "read", [&]
+    {
+        items.clear();
+        pugi_serializer::reader reader_serializer(_doc.document_element());
+        for (const auto& path : _paths)
+            read_items(static_cast<pugi_serializer::serializer_base&>(reader_serializer), path, 0, items);
+        return items.size();
+    });
+    read_result.container = _item_name;
+    _results.push_back(read_result);
+
+    measurement build_result = measure(_options, "build", [&]
+    {
+        pugi::xml_document write_doc;
+        pugi_serializer::writer writer_serializer(write_doc, "mondial");
+        pugi_serializer::serialize_container(writer_serializer, items, _item_name);
+        return items.size();
+    });
+    build_result.container = _item_name;
+    _results.push_back(build_result);
+}
+
+static void bench_input(const options& _options, const std::string& _text, const std::string& _input_name, const int _scale, std::vector<measurement>& _results)
+{
+    const size_t first_result = _results.size();
+
+    pugi::xml_document doc;
+    _results.push_back(measure(_options, "parse", [&]
+    {
+        doc.load_buffer(_text.data(), _text.size(), bench_parse_options);
+        return _text.size();
+    }));
+
+    world w;
+    _results.push_back(measure(_options, "read", [&]
+    {
+        w = world();
+        pugi_serializer::reader reader_serializer(doc);
+        w.serialize(reader_serializer);
+        return w.country_vec.size();
+    }));
+
+    _results.push_back(measure(_options, "read_static", [&]
+    {
+        world static_world;
+        pugi_serializer::static_reader reader_serializer(doc);
+        static_world.serialize(reader_serializer);
+        return static_world.country_vec.size();
+    }));
+
+    _results.push_back(measure(_options, "read_from_chars", [&]
+    {
+        world from_chars_world;
+        pugi_serializer::reader reader_serializer(doc);
+        reader_serializer.set_should_use_from_chars(true);
+        from_chars_world.serialize(reader_serializer);
+        return from_chars_world.country_vec.size();
+    }));
+
+    size_t num_answer_provinces = 0;     // the answer uses the provinces of one country
+    _results.push_back(measure(_options, "first_answer", [&]
+    {
+        std::vector<country> countries;
+        pugi_serializer::reader reader_serializer(doc);
+        pugi_serializer::serialize_container(reader_serializer, countries, "country");
+        if (!countries.empty())
+            num_answer_provinces = countries[countries.size() / 2].provinces_vec.size();
+        return countries.size();
+    }));
+
+    _results.push_back(measure(_options, "first_answer_lazy", [&]
+    {
+        std::vector<pugi_serializer::lazy<country>> countries;
+        pugi_serializer::reader reader_serializer(doc);
+        pugi_serializer::serialize_container(reader_serializer, countries, "country");
+        if (!countries.empty())
+            num_answer_provinces = countries[countries.size() / 2]->provinces_vec.size();
+        return countries.size();
+    }));
+
+    _results.push_back(measure(_options, "resolve_map", [&]
+    {
+        world resolved_world;
+        pugi_serializer::reader reader_serializer(doc);
+        resolved_world.serialize(reader_serializer);
+        std::map<std::string, const city*> cities;
+        std::map<std::string, const country*> countries;
+        for (const country& a_country : resolved_world.country_vec)
+        {
+            countries.emplace(a_country.id, &a_country);
+            for (const city& a_city : a_country.cities_vec)
+                cities.emplace(a_city.id, &a_city);
+            for (const province& a_province : a_country.provinces_vec)
+                for (const city& a_city : a_province.cities_vec)
+                    cities.emplace(a_city.id, &a_city);
+        }
+        size_t num_resolved = 0;
+        for (const country& a_country : resolved_world.country_vec)
+        {
+            num_resolved += cities.count(a_country.capital.id());
+            for (const border& a_border : a_country.borders_vec)
+                num_resolved += countries.count(a_border.country.id());
+        }
+        return num_resolved;
+    }));
+
+    _results.push_back(measure(_options, "resolve_index", [&]
+    {
+        world resolved_world;
+        pugi_serializer::id_index index;
+        pugi_serializer::reader reader_serializer(doc);
+        reader_serializer.set_id_index(&index);
+        resolved_world.serialize(reader_serializer);
+        index.resolve();
+        size_t num_resolved = 0;
+        for (const country& a_country : resolved_world.country_vec)
+        {
+            num_resolved += bool(a_country.capital);
+            for (const border& a_border : a_country.borders_vec)
+                num_resolved += bool(a_border.country);
+        }
+        return num_resolved;
+    }));
+
+    pugi::xml_document write_doc;
+    _results.push_back(measure(_options, "build", [&]
+    {
+        write_doc.reset();
+        pugi_serializer::writer writer_serializer(write_doc, "mondial");
+        w.serialize(writer_serializer);
+        return w.country_vec.size();
+    }));
+
+    _results.push_back(measure(_options, "save", [&]
+    {
+        return save_to_string(write_doc).size();
+    }));
+
+    _results.push_back(measure(_options, "build_static", [&]
+    {
+        pugi::xml_document static_doc;
+        pugi_serializer::static_writer writer_serializer(static_doc, "mondial");
+        w.serialize(writer_serializer);
+        return w.country_vec.size();
+    }));
+
+    _results.push_back(measure(_options, "build_to_chars", [&]
+    {
+        pugi::xml_document to_chars_doc;
+        pugi_serializer::writer writer_serializer(to_chars_doc, "mondial");
+        writer_serializer.set_should_use_to_chars(true);
+        w.serialize(writer_serializer);
+        return w.country_vec.size();
+    }));
+
+    std::string stream_out;
+    _results.push_back(measure(_options, "write_stream", [&]
+    {
+        stream_out.clear();
+        pugi_serializer::stream_writer writer_serializer(stream_out, "mondial");
+        w.serialize(writer_serializer);
+        writer_serializer.finish();
+        return stream_out.size();
+    }));
+
+    _results.push_back(measure(_options, "write_countries", [&]
+    {
+        stream_out.clear();
+        pugi_serializer::stream_writer writer_serializer(stream_out, "mondial");
+        pugi_serializer::serialize_container(writer_serializer, w.country_vec, "country");
+        writer_serializer.finish();
+        return w.country_vec.size();
+    }));
+
+    pugi_serializer::thread_pool pool;
+    _results.push_back(measure(_options, "write_countries_parallel", [&]
+    {
+        stream_out.clear();
+        pugi_serializer::stream_writer writer_serializer(stream_out, "mondial");
+        writer_serializer.set_thread_pool(&pool);
+        pugi_serializer::serialize_container_parallel(writer_serializer, w.country_vec, "country");
+        writer_serializer.finish();
+        return w.country_vec.size();
+    }));
+
+    std::string binary_out;
+    _results.push_back(measure(_options, "write_binary", [&]
+    {
+        binary_out.clear();
+        pugi_serializer::binary_writer writer_serializer(binary_out, "mondial");
+        w.serialize(writer_serializer);
+        return binary_out.size();
+    }));
+
+    _results.push_back(measure(_options, "read_binary", [&]
+    {
+        world binary_world;
+        pugi_serializer::binary_reader reader_serializer(binary_out);
+        binary_world.serialize(reader_serializer);
+        return binary_world.country_vec.size();
+    }));
+
+    _results.push_back(measure(_options, "round_trip", [&]
+    {
+        pugi::xml_document read_doc;
+        read_doc.load_buffer(_text.data(), _text.size(), bench_parse_options);
+        world round_trip_world;
+        pugi_serializer::reader reader_serializer(read_doc);
+        round_trip_world.serialize(reader_serializer);
+
+        pugi::xml_document round_trip_doc;
+        pugi_serializer::writer writer_serializer(round_trip_doc, "mondial");
+        round_trip_world.serialize(writer_serializer);
+        return save_to_string(round_trip_doc).size();
+    }));
+
+    const std::vector<std::string> messages = item_messages(doc, "country");
+    string_xml_writer answer;
+    _results.push_back(measure(_options, "messages", [&]
+    {
+        for (const std::string& message : messages)
+        {
+            pugi::xml_document message_doc;
+            message_doc.load_buffer(message.data(), message.size(), bench_parse_options);
+            country message_country;
+            pugi_serializer::reader reader_serializer(message_doc);
+            message_country.serialize(reader_serializer);
+
+            pugi::xml_document answer_doc;
+            pugi_serializer::writer writer_serializer(answer_doc, "country");
+            message_country.serialize(writer_serializer);
+            answer.text.clear();
+            answer_doc.save(answer);
+        }
+        return messages.size();
+    }));
+
+    pugi_serializer::session message_session(1024 * 1024, _options.huge_pages);
+    _results.push_back(measure(_options, "messages_session", [&]
+    {
+        for (const std::string& message : messages)
+        {
+            message_session.load_buffer(message.data(), message.size(), bench_parse_options);
+            country message_country;
+            {
+                pugi_serializer::reader reader_serializer(message_session);
+                message_country.serialize(reader_serializer);
+            }
+
+            {
+                pugi_serializer::writer writer_serializer(message_session, "country");
+                message_country.serialize(writer_serializer);
+            }
+            answer.text.clear();
+            message_session.document().save(answer);
+        }
+        return messages.size();
+    }));
+
+    measure_container<continent>(_options, doc, "continent", {{"continent"}}, _results);
+    measure_container<country>(_options, doc, "country", {{"country"}}, _results);
+    measure_container<province>(_options, doc, "province", {{"country", "province"}}, _results);
+    measure_container<city>(_options, doc, "city", {{"country", "city"}, {"country", "province", "city"}}, _results);
+    measure_container<organization>(_options, doc, "organization", {{"organization"}}, _results);
+    measure_container<mountain>(_options, doc, "mountain", {{"mountain"}}, _results);
+    measure_container<desert>(_options, doc, "desert", {{"desert"}}, _results);
+    measure_container<island>(_options, doc, "island", {{"island"}}, _results);
+    measure_container<river>(_options, doc, "river", {{"river"}}, _results);
+    measure_container<sea>(_options, doc, "sea", {{"sea"}}, _results);
+    measure_container<lake>(_options, doc, "lake", {{"lake"}}, _results);
+
+    for (size_t i = first_result; i < _results.size(); ++i)
+    {
+        _results[i].input = _input_name;
+        _results[i].scale = _scale;
+    }
+}
+
+static size_t num_children(pugi::xml_node _node)
+{
+    size_t count = 0;
+    for (pugi::xml_node child = _node.first_child(); child; child = child.next_sibling())
+        ++count;
+    return count;
+}
+
+// loading --file from disk, with and without mapping it
+static void bench_file_loading(const options& _options, std::vector<measurement>& _results)
+{
+    const size_t first_result = _results.size();
+    _results.push_back(measure(_options, "load_file", [&]
+    {
+        pugi::xml_document doc;
+        doc.load_file(_options.file_name.c_str(), bench_parse_options);
+        return num_children(doc.document_element());
+    }));
+
+    _results.push_back(measure(_options, "load_mapped_file", [&]
+    {
+        auto doc = pugi_serializer::load_mapped_file(_options.file_name.c_str(), bench_parse_options, pugi_serializer::map_hint_sequential);
+        return num_children(doc->document_element());
+    }));
+
+    for (size_t i = first_result; i < _results.size(); ++i)
+        _results[i].input = _options.file_name;
+}
+
+static void print_csv(const std::vector<measurement>& _results)
+{
+    std::cout << "input,scale,phase,container,items,min_ms,mean_ms,peak_rss_kb,allocations,allocated_bytes\n";
+    for (const measurement& m : _results)
+        std::cout << m.input << ',' << m.scale << ',' << m.phase << ',' << m.container << ',' << m.items << ','
+                  << m.min_ms << ',' << m.mean_ms << ',' << m.peak_rss_kb << ',' << m.allocations << ',' << m.allocated_bytes << '\n';
+}
+
+static void print_json(const std::vector<measurement>& _results)
+{
+    for (const measurement& m : _results)
+        std::cout << "{\"input\":\"" << m.input << "\",\"scale\":" << m.scale << ",\"phase\":\"" << m.phase
+                  << "\",\"container\":\"" << m.container << "\",\"items\":" << m.items
+                  << ",\"min_ms\":" << m.min_ms << ",\"mean_ms\":" << m.mean_ms << ",\"peak_rss_kb\":" << m.peak_rss_kb
+                  << ",\"allocations\":" << m.allocations << ",\"allocated_bytes\":" << m.allocated_bytes << "}\n";
+}
+
+static bool parse_options(int argc, char* argv[], options& _options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (0 == std::strcmp(argv[i], "--file") && has_value)
+            _options.file_name = argv[++i];
+        else if (0 == std::strcmp(argv[i], "--iterations") && has_value)
+            _options.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (0 == std::strcmp(argv[i], "--scales") && has_value)
+        {
+            _options.scales.clear();
+            std::istringstream scales(argv[++i]);
+            for (std::string scale; std::getline(scales, scale, ',');)
+                if (int scale_value = std::atoi(scale.c_str()); scale_value > 0)
+                    _options.scales.push_back(scale_value);
+        }
+        else if (0 == std::strcmp(argv[i], "--generate") && has_value)
+        {
+            std::istringstream sizes(argv[++i]);
+            for (std::string size; std::getline(sizes, size, ',');)
+            {
+                size_t size_value = std::strtoull(size.c_str(), nullptr, 10);
+                switch (size.empty() ? '\0' : size.back())
+                {
+                    case 'k': case 'K': size_value *= 1024; break;
+                    case 'm': case 'M': size_value *= 1024 * 1024; break;
+                    case 'g': case 'G': size_value *= 1024 * 1024 * 1024; break;
+                    default: break;
+                }
+                if (size_value > 0)
+                    _options.generated_sizes.push_back(size_value);
+            }
+        }
+        else if (0 == std::strcmp(argv[i], "--seed") && has_value)
+            _options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (0 == std::strcmp(argv[i], "--huge-pages"))
+            _options.huge_pages = true;
+        else if (0 == std::strcmp(argv[i], "--json"))
+            _options.json = true;
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    options bench_options;
+    if (!parse_options(argc, argv, bench_options))
+    {
+        std::cerr << "usage: " << argv[0] << " [--file tests/mondial-3.0.xml] [--scales 1,10,100] [--generate 10m,100m [--seed 1]] [--iterations 5] [--huge-pages] [--json]" << std::endl;
+        return 2;
+    }
+
+    pugi::set_memory_management_functions(counted_malloc, std::free);
+    pugi_serializer::session::install_memory_functions();     // for messages_session, allocations are still counted
+
+    std::vector<measurement> results;
+    if (!bench_options.generated_sizes.empty())
+    {
+        for (size_t generated_size : bench_options.generated_sizes)
+        {
+            generator_options generate_options;
+            generate_options.seed = bench_options.seed;
+            generate_options.target_bytes = generated_size;
+            pugi::xml_document generated_doc;
+            generate_document(generate_options, generated_doc);
+            const std::string input_name = "generated-" + std::to_string(generated_size) + "-seed-" + std::to_string(bench_options.seed);
+            bench_input(bench_options, save_to_string(generated_doc), input_name, 1, results);
+        }
+    }
+    else
+    {
+        pugi::xml_document source_doc;
+        pugi::xml_parse_result parse_result = source_doc.load_file(bench_options.file_name.c_str(), bench_parse_options);
+        if (pugi::status_ok != parse_result.status)
+        {
+            std::cerr << "failed to read " << bench_options.file_name << ": " << parse_result.description() << std::endl;
+            return 1;
+        }
+        for (int scale : bench_options.scales)
+            bench_input(bench_options, scaled_text(source_doc, scale), bench_options.file_name, scale, results);
+        bench_file_loading(bench_options, results);
+    }
+
+    if (bench_options.json)
+        print_json(results);
+    else
+        print_csv(results);
+    return 0;
+}
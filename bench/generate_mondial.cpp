@@ -0,0 +1,66 @@
+// write a synthetic mondial document of a given size, see tests/mondial_generator.hpp
+//
+// usage: generate_mondial --bytes 100m [--seed 1] [--provinces 8] [--cities 6] [--fill 0.8] [-o mondial-100m.xml]
+// sizes can have a k, m or g suffix. without -o the document is written to stdout.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "pugixml.hpp"
+#include "mondial_generator.hpp"
+
+// "100", "64k", "100m", "2g"
+static size_t parse_size(const char* _text)
+{
+    char* end = nullptr;
+    size_t size = std::strtoull(_text, &end, 10);
+    switch (*end)
+    {
+        case 'k': case 'K': size *= 1024; break;
+        case 'm': case 'M': size *= 1024 * 1024; break;
+        case 'g': case 'G': size *= 1024 * 1024 * 1024; break;
+        default: break;
+    }
+    return size;
+}
+
+int main(int argc, char* argv[])
+{
+    generator_options options;
+    const char* out_file_name = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (0 == std::strcmp(argv[i], "--bytes") && has_value)
+            options.target_bytes = parse_size(argv[++i]);
+        else if (0 == std::strcmp(argv[i], "--seed") && has_value)
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (0 == std::strcmp(argv[i], "--provinces") && has_value)
+            options.provinces_per_country = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (0 == std::strcmp(argv[i], "--cities") && has_value)
+            options.cities_per_province = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (0 == std::strcmp(argv[i], "--fill") && has_value)
+            options.attribute_fill = std::atof(argv[++i]);
+        else if (0 == std::strcmp(argv[i], "-o") && has_value)
+            out_file_name = argv[++i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " --bytes 100m [--seed 1] [--provinces 8] [--cities 6] [--fill 0.8] [-o mondial-100m.xml]" << std::endl;
+            return 2;
+        }
+    }
+
+    pugi::xml_document doc;
+    generate_document(options, doc);
+
+    if (nullptr == out_file_name)
+        doc.save(std::cout);
+    else if (!doc.save_file(out_file_name))
+    {
+        std::cerr << "failed to write " << out_file_name << std::endl;
+        return 1;
+    }
+    return 0;
+}
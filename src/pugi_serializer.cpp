@@ -16,6 +16,32 @@
 
 #include "pugi_serializer.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace pugi_serializer
 {
 std::strong_ordering operator<=>(const pugi_serializer::serialized_base&,
@@ -47,14 +73,32 @@ public:
     bool writing() const { return !_reading;}
     void set_should_write_default_values(const bool _should_write_default_values) { _write_default_values = _should_write_default_values; }
     bool get_should_write_default_values() {return _write_default_values;}
+    void set_observer(observer* _in_observer) { _observer = _in_observer; }
+    void set_tracer(trace_writer* _in_tracer) { _tracer = _in_tracer; }
+    trace_writer* get_tracer() const { return _tracer; }
+    void set_memory_resource(std::pmr::memory_resource* _resource) { _memory_resource = _resource; }
+    std::pmr::memory_resource* get_memory_resource() const { return _memory_resource; }
+    void set_id_index(id_index* _index) { _id_index = _index; }
+    id_index* get_id_index() const { return _id_index; }
 
     virtual void node_name(pugi::xml_node _node, std::string& _name) = 0;
-    virtual pugi::xml_node child(pugi::xml_node _node, const char* _name) = 0;
-    virtual pugi::xml_node next_sibling(pugi::xml_node _node, const char* _name) = 0;
+    virtual const char* node_name(pugi::xml_node _node) { return _node.name(); }
+    virtual pugi::xml_node child(pugi::xml_node _node, const name_token& _name) = 0;
+    // _last_child: child previously returned for _node, updated with the returned child
+    virtual pugi::xml_node child(pugi::xml_node _node, const name_token& _name, pugi::xml_node& _last_child)
+    {
+        _last_child = child(_node, _name);
+        return _last_child;
+    }
+    virtual pugi::xml_node next_sibling(pugi::xml_node _node, const name_token& _name) = 0;
+    virtual pugi::xml_node first_child(pugi::xml_node _node) = 0;
+    virtual pugi::xml_node next_sibling(pugi::xml_node _node) = 0;
 
     virtual const char* c_str(pugi::xml_node _node, const char* _c_str) = 0;
     virtual void text(pugi::xml_node _node, std::string& _text) = 0;
     virtual void text(pugi::xml_node _node, std::string& _text, std::string_view default_text) = 0;
+    virtual void text(pugi::xml_node _node, std::string_view& _text) = 0;
+    virtual void text(pugi::xml_node _node, std::string_view& _text, std::string_view default_text) = 0;
     virtual void text(pugi::xml_node _node, int& _int) = 0;
     virtual void text(pugi::xml_node _node, int& _int, const int def) = 0;
     virtual void text(pugi::xml_node _node, unsigned& _uint) = 0;
@@ -72,354 +116,3520 @@ public:
     
     virtual void cdata(pugi::xml_node _node, std::string& _text) = 0;
 
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, std::string& _text) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, std::string& _text, std::string_view default_text) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, int& _int) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, int& _int, const int def) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned& _uint) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned& _uint, const unsigned def) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, float& _float) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, float& _float, const float def) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, double& _double) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, double& _double, const double def) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, bool& _bool) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, bool& _bool, const bool def) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, long long& _llint) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, long long& _llint, const long long def) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned long long& _ullint) = 0;
-    virtual void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned long long& _ullint, const unsigned long long def) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string& _text) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string& _text, std::string_view default_text) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string_view& _text) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string_view& _text, std::string_view default_text) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, int& _int) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, int& _int, const int def) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned& _uint) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned& _uint, const unsigned def) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, float& _float) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, float& _float, const float def) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, double& _double) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, double& _double, const double def) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, bool& _bool) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, bool& _bool, const bool def) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, long long& _llint) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, long long& _llint, const long long def) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned long long& _ullint) = 0;
+    virtual void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned long long& _ullint, const unsigned long long def) = 0;
+
+    // used by task_reader: a new implementor with the same settings, to be used on another thread,
+    // and adding the results of such an implementor back to this one. nullptr if not supported.
+    virtual impl_base* clone_settings() const { return nullptr; }
+    virtual void merge_results(impl_base&) {}
+    virtual thread_pool* get_thread_pool() const { return nullptr; }
+    virtual std::shared_ptr<pugi::xml_document> document() const { return nullptr; }
+    virtual std::shared_ptr<const reader_settings> share_settings() { return nullptr; }
+    // false when the nodes given to the virtual functions are ids of the implementor's own elements, see has_document_nodes()
+    virtual bool has_document_nodes() const { return true; }
+
+    // used by fragment_writer: a new implementor with the same settings, that writes children of _parent_node
+    // into a separate output, and adding that output to this one. nullptr if not supported.
+    virtual impl_base* new_fragment(pugi::xml_node) { return nullptr; }
+    virtual pugi::xml_node fragment_root() { return pugi::xml_node(); }
+    virtual void append_fragment(pugi::xml_node, impl_base&) {}
+
+    // serialize each binding in order with the single attribute functions above
+    virtual void attributes(pugi::xml_node _node, const attribute_binding* _bindings, const size_t _num_bindings)
+    {
+        for (size_t i = 0; i < _num_bindings; ++i)
+        {
+            const attribute_binding& binding = _bindings[i];
+            binding.visit([&](auto& _val, auto def)
+            {
+                if (binding.has_default)
+                    attribute(_node, binding.name, _val, def);
+                else
+                    attribute(_node, binding.name, _val);
+            });
+        }
+    }
 
 protected:
     bool _reading = true;
     bool _write_default_values = true;
+    observer* _observer = nullptr;  // checked before each notification, so nothing is measured without an observer
+    trace_writer* _tracer = nullptr;
+    std::pmr::memory_resource* _memory_resource = nullptr;
+    id_index* _id_index = nullptr;
 };
 
-class writer_impl : public impl_base
+// used when there is an observer: the length of a string value, 0 for other values
+template<typename TValue>
+size_t string_size(const TValue& _val)
 {
-public:
-    
-    writer_impl()
+    if constexpr (std::is_same_v<TValue, std::string> || std::is_same_v<TValue, std::string_view>)
+        return _val.size();
+    else
+        return 0;
+}
+
+// used when there is an observer: number of names compared by a search that started at _first and stopped at _found,
+// or by a search of all of them if nothing was found
+inline size_t count_scanned(pugi::xml_node _first, pugi::xml_node _found)
+{
+    size_t scanned = 0;
+    for (pugi::xml_node a_node = _first; a_node; a_node = a_node.next_sibling())
     {
-        _reading = false;
+        ++scanned;
+        if (a_node == _found)
+            break;
     }
-    
-    void node_name(pugi::xml_node _node, std::string& _name) override
+    return scanned;
+}
+
+inline size_t count_scanned(pugi::xml_attribute _first, pugi::xml_attribute _found)
+{
+    size_t scanned = 0;
+    for (pugi::xml_attribute an_attrib = _first; an_attrib; an_attrib = an_attrib.next_attribute())
     {
-        _node.set_name(_name.c_str());
+        ++scanned;
+        if (an_attrib == _found)
+            break;
     }
+    return scanned;
+}
+
+// writes to a pugi::xml_document
+class arena;
 
-    pugi::xml_node child(pugi::xml_node _node, const char* _name) override
+// the arena pugixml allocates from on this thread, see arena_scope
+static thread_local arena* active_arena = nullptr;
+
+// memory allocated by pugixml on this thread comes from _arena while an arena_scope exists.
+// Nothing changes if _arena is nullptr.
+class arena_scope
+{
+public:
+    explicit arena_scope(arena* _arena)
+    : _previous(active_arena)
     {
-        auto new_node = _node.append_child();
-        new_node.set_name(_name);
-        return new_node;
+        if (nullptr != _arena)
+            active_arena = _arena;
     }
 
-    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const char* _name) override
+    ~arena_scope()
     {
-        auto younger_sibling = older_sibling.parent().insert_child_after(_name, older_sibling);
-        return younger_sibling;
+        active_arena = _previous;
     }
 
-    void text(pugi::xml_node _node, std::string& _text) override
+    arena_scope(const arena_scope&) = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+
+private:
+    arena* _previous;
+};
+
+class dom_output
+{
+public:
+    arena* _arena = nullptr;    // the session's arena when writing a session's document, see writer(session&)
+
+    void set_name(pugi::xml_node _node, const std::string& _name)
     {
-        _node.text().set(_text.c_str());
+        arena_scope scope(_arena);
+        _node.set_name(_name.c_str());
     }
-    
-    void text(pugi::xml_node _node, std::string& _text, std::string_view default_text) override
+
+    const char* name(pugi::xml_node _node) { return _node.name(); }
+
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name)
     {
-        if (_text != default_text)
-        {
-            text(_node, _text);
-        }
+        arena_scope scope(_arena);
+        return append_child(_node, _name);
     }
-    
-    const char* c_str(pugi::xml_node _node, const char* _c_str) override
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const name_token& _name)
     {
-        _node.text().set(_c_str);
-        return _c_str;
+        arena_scope scope(_arena);
+        auto younger_sibling = older_sibling.parent().insert_child_after(_name.c_str(), older_sibling);
+        return younger_sibling;
     }
 
     template<typename TToWrite>
-    void write_node_value(pugi::xml_node _node, TToWrite& _val)
+    void text(pugi::xml_node _node, const TToWrite& _val, char* _to_chars_buffer)
     {
-        _node.text().set(_val);
+        arena_scope scope(_arena);
+        write_text(_node, _val, _to_chars_buffer);
     }
-    
-    template<typename TToWrite>
-    void write_node_value_with_default(pugi::xml_node _node, TToWrite& _val, const TToWrite def)
+
+    void text(pugi::xml_node _node, const char* _c_str)
     {
-        if (_write_default_values || def != _val)
-            write_node_value(_node, _val);
+        arena_scope scope(_arena);
+        _node.text().set(_c_str);
     }
 
-    void text(pugi::xml_node _node, int& _val) override
-        { write_node_value(_node, _val); }
-    void text(pugi::xml_node _node, int& _val, const int def) override
-        { write_node_value_with_default(_node, _val, def); }
-    
-    void text(pugi::xml_node _node, unsigned& _val) override
-        { write_node_value(_node, _val); }
-    void text(pugi::xml_node _node, unsigned& _val, const unsigned def) override
-        { write_node_value_with_default(_node, _val, def); }
-    
-    void text(pugi::xml_node _node, float& _val) override
-        { write_node_value(_node, _val); }
-    void text(pugi::xml_node _node, float& _val, const float def) override
-        { write_node_value_with_default(_node, _val, def); }
-    
-    void text(pugi::xml_node _node, double& _val) override
-        { write_node_value(_node, _val); }
-    void text(pugi::xml_node _node, double& _val, const double def) override
-        { write_node_value_with_default(_node, _val, def); }
-    
-    void text(pugi::xml_node _node, bool& _val) override
-        { write_node_value(_node, _val); }
-    void text(pugi::xml_node _node, bool& _val, const bool def) override
-        { write_node_value_with_default(_node, _val, def); }
-    
-    void text(pugi::xml_node _node, long long& _val) override
-        { write_node_value(_node, _val); }
-    void text(pugi::xml_node _node, long long& _val, const long long def) override
-        { write_node_value_with_default(_node, _val, def); }
-    
-    void text(pugi::xml_node _node, unsigned long long& _val) override
-        { write_node_value(_node, _val); }
-    void text(pugi::xml_node _node, unsigned long long& _val, const unsigned long long def) override
-        { write_node_value_with_default(_node, _val, def); }
-    
-    void cdata(pugi::xml_node _node, std::string& _text) override
+    // a fragment is written to its own document, and copied to the parent when done
+    pugi::xml_node start_fragment(dom_output&, pugi::xml_node)
     {
-        _node.append_child(pugi::node_cdata).set_value(_text.c_str());
+        _fragment_doc = std::make_unique<pugi::xml_document>();
+        return *_fragment_doc;
     }
 
-    void attribute(pugi::xml_node _node, const char* _attrib_name, std::string& _text) override
+    void append_fragment(pugi::xml_node _parent_node, dom_output& _fragment)
     {
-        _node.append_attribute(_attrib_name) = _text.c_str();
+        arena_scope scope(_arena);
+        for (pugi::xml_node item = _fragment._fragment_doc->first_child(); item; item = item.next_sibling())
+            _parent_node.append_copy(item);
     }
-    
-    // do not append the attribute if _text is equal to default_text
-    void attribute(pugi::xml_node _node, const char* _attrib_name, std::string& _text, std::string_view default_text) override
+
+    void cdata(pugi::xml_node _node, const std::string& _text)
     {
-        if (_write_default_values || _text != default_text)
-            _node.append_attribute(_attrib_name) = _text.c_str();
+        arena_scope scope(_arena);
+        _node.append_child(pugi::node_cdata).set_value(_text.c_str());
     }
-    
+
     template<typename TToWrite>
-    void write_attribute_value(pugi::xml_node _node, const char* _attrib_name, TToWrite& _to_write)
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, const TToWrite& _val, char* _to_chars_buffer)
     {
-        _node.append_attribute(_attrib_name).set_value(_to_write);
+        arena_scope scope(_arena);
+        write_attribute(_node, _attrib_name, _val, _to_chars_buffer);
     }
-    
-    template<typename TToWrite>
-    void write_attribute_value_with_default(pugi::xml_node _node, const char* _attrib_name, TToWrite& _to_write, const TToWrite def)
-    // do not write the value if it's equal to the default
+
+private:
+    std::unique_ptr<pugi::xml_document> _fragment_doc;
+};
+
+// writes xml text directly, as the serialize functions are called, without building a pugi::xml_document.
+// The output is the same as pugi::xml_document::save with the same indent and flags.
+// The pugi::xml_node objects passed to stream_output are not real nodes, but ids of the elements created by child().
+// Elements are kept on a stack while they are open:
+// - an element's start tag is written when it's first needed, so the element can still be renamed until then
+// - text is kept until the start tag is closed, so it can be set before or after the attributes
+// - attributes written after the start tag was closed, e.g. after a child, are inserted into the start tag
+//   as long as it was not flushed yet
+// Calls to an element that is already closed, or attributes to a start tag that was flushed, cannot be written
+// and are counted by out_of_order_count.
+class stream_output
+{
+public:
+    stream_output() = default;
+    stream_output(const stream_output&) = delete;
+    stream_output& operator=(const stream_output&) = delete;
+
+    // _out: where the xml is written, or nullptr to write to an internal buffer
+    // _flush: if not null, called with the written xml when it grows over flush_size and in finish()
+    void start(std::string* _out, std::function<void(const std::string&)> _flush, const char* doc_element_name, const char* _indent, const unsigned int _flags)
     {
-        if (_write_default_values || _to_write != def)
+        _out_str = nullptr != _out ? _out : &_own_buffer;
+        _flush_func = std::move(_flush);
+        _indent_str = _indent;
+        _format_flags = _flags;
+        _raw = 0 != (_flags & pugi::format_raw);
+        _indent_length = (0 != (_flags & pugi::format_indent) && !_raw) ? std::strlen(_indent) : 0;
+
+        if (0 == (_flags & pugi::format_no_declaration))
         {
-            write_attribute_value(_node, _attrib_name, _to_write);
+            _out_str->append("<?xml version=\"1.0\"?>");
+            if (!_raw)
+                _out_str->push_back('\n');
         }
+        _indent_flags = indent_indent;
+        push(doc_element_name);
     }
 
-    void attribute(pugi::xml_node _node, const char* _attrib_name, int& _val) override
-        { write_attribute_value(_node, _attrib_name, _val); }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, int& _val, const int def) override
-        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned& _val) override
-        { write_attribute_value(_node, _attrib_name, _val); }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned& _val, const unsigned def) override
-        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, float& _val) override
-        { write_attribute_value(_node, _attrib_name, _val); }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, float& _val, const float def) override
-        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, double& _val) override
-        { write_attribute_value(_node, _attrib_name, _val); }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, double& _val, const double def) override
-        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, bool& _val) override
-        { write_attribute_value(_node, _attrib_name, _val); }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, bool& _val, const bool def) override
-        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, long long& _val) override
-        { write_attribute_value(_node, _attrib_name, _val); }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, long long& _val, const long long def) override
-        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned long long& _val) override
-        { write_attribute_value(_node, _attrib_name, _val); }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned long long& _val, const unsigned long long def) override
-        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+    // close all open elements and flush the output
+    void finish()
+    {
+        if (nullptr == _out_str)
+            return;
 
-};
+        while (0 != _num_open)
+            close_top();
+        if (0 != (_indent_flags & indent_newline) && !_raw)
+            _out_str->push_back('\n');
+        flush();
+        _out_str = nullptr;
+    }
 
-class reader_impl : public impl_base
-{
-public:
-    
-    void node_name(pugi::xml_node _node, std::string& _name) override
+    pugi::xml_node root() { return to_node(_elements[0].id); }
+    size_t out_of_order_count() const { return _out_of_order_count; }
+
+    // a fragment writes children of _parent_node to its own buffer, indented as they would be in _parent.
+    // The fragment's root stands for _parent_node. The indent before the first child is written by append_fragment,
+    // since it depends on what was written to _parent before.
+    pugi::xml_node start_fragment(stream_output& _parent, pugi::xml_node _parent_node)
     {
-        _name = _node.name();
+        _out_str = &_own_buffer;
+        _indent_str = _parent._indent_str;
+        _indent_length = _parent._indent_length;
+        _format_flags = _parent._format_flags;
+        _raw = _parent._raw;
+        _indent_flags = 0;
+
+        element* parent_element = _parent.make_top(_parent_node);
+        if (nullptr == parent_element)
+            return pugi::xml_node();
+        _parent.close_start_tag(*parent_element);
+        _depth_offset = _parent._depth_offset + static_cast<size_t>(parent_element - _parent._elements.data());
+
+        pugi::xml_node fragment_root = push("");
+        _elements[0].state = element_state::content;
+        return fragment_root;
     }
 
-    pugi::xml_node child(pugi::xml_node _node, const char* _name) override
+    void append_fragment(pugi::xml_node _parent_node, stream_output& _fragment)
     {
-        auto a_child_node = _node.child(_name);
-        return a_child_node;
+        _out_of_order_count += _fragment._out_of_order_count;
+        if (0 == _fragment._num_open)   // start_fragment failed
+            return;
+        while (_fragment._num_open > 1)
+            _fragment.close_top();
+        if (_fragment._own_buffer.empty() || nullptr == make_top(_parent_node))
+            return;
+
+        write_indent(_fragment._depth_offset - _depth_offset + 1);
+        _out_str->append(_fragment._own_buffer);
+        _indent_flags = indent_newline | indent_indent;
+        if (_out_str->size() >= flush_size)
+            flush();
     }
 
-    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const char* _name) override
+    void set_name(pugi::xml_node _node, const std::string& _name)
     {
-        auto younger_sibling = older_sibling.next_sibling(_name);
-        return younger_sibling;
+        if (element* e = make_top(_node); nullptr != e)
+        {
+            if (element_state::not_written == e->state)
+                e->name = _name;
+            else
+                ++_out_of_order_count;
+        }
     }
-    
-    const char* c_str(pugi::xml_node _node, const char*) override
+
+    const char* name(pugi::xml_node _node)
     {
-        return _node.text().as_string();
+        for (size_t i = _num_open; i > 0; --i)
+            if (_elements[i - 1].id == to_id(_node))
+                return _elements[i - 1].name.c_str();
+        return "";
     }
 
-    void text(pugi::xml_node _node, std::string& _text) override
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name)
     {
-        _text = _node.text().as_string();
+        if (nullptr == make_top(_node))
+            return pugi::xml_node();
+        close_start_tag(_elements[_num_open - 1]);
+        return push(_name.c_str());
     }
-    
-    void text(pugi::xml_node _node, std::string& _text, std::string_view default_text) override
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const name_token& _name)
+    {
+        if (nullptr == make_top(older_sibling))
+            return pugi::xml_node();
+        close_top();
+        if (0 != _num_open)
+            close_start_tag(_elements[_num_open - 1]);
+        return push(_name.c_str());
+    }
+
+    template<typename TToWrite>
+    void text(pugi::xml_node _node, const TToWrite& _val, char* _to_chars_buffer)
+    {
+        text(_node, format(_val, _to_chars_buffer));
+    }
+
+    void text(pugi::xml_node _node, const std::string_view _text)
     {
-        if (_node.text())
+        element* e = make_top(_node);
+        if (nullptr == e)
+            return;
+
+        if (element_state::content != e->state)
         {
-            _text = _node.text().as_string();
+            e->has_text = true;
+            e->text = _text;
         }
-        else
+        else if (!e->text_written)  // text after children
         {
-            _text = default_text;
+            write_escaped(*_out_str, _text, false);
+            e->text_written = true;
+            _indent_flags = 0;
         }
+        else
+            ++_out_of_order_count;
     }
 
-    void text(pugi::xml_node _node, int& _val) override
-    { _val = _node.text().as_int(); }
-    void text(pugi::xml_node _node, int& _val, const int def) override
-    { _val = _node.text().as_int(def); }
+    void cdata(pugi::xml_node _node, const std::string& _text)
+    {
+        element* e = make_top(_node);
+        if (nullptr == e)
+            return;
 
-    void text(pugi::xml_node _node, unsigned& _val) override
-    { _val = _node.text().as_uint(); }
-    void text(pugi::xml_node _node, unsigned& _val, const unsigned def) override
-    { _val = _node.text().as_uint(def); }
+        close_start_tag(*e);
+        // "]]>" cannot appear in a CDATA section, so it's split between two sections, same as pugixml
+        const char* s = _text.c_str();
+        do
+        {
+            _out_str->append("<![CDATA[");
+            const char* prev = s;
+            while (*s && !(s[0] == ']' && s[1] == ']' && s[2] == '>'))
+                ++s;
+            if (*s)
+                s += 2;
+            _out_str->append(prev, static_cast<size_t>(s - prev));
+            _out_str->append("]]>");
+        }
+        while (*s);
+        _indent_flags = 0;
+    }
 
-    void text(pugi::xml_node _node, float& _val) override
-    { _val = _node.text().as_float(); }
-    void text(pugi::xml_node _node, float& _val, const float def) override
-    { _val = _node.text().as_float(def); }
+    template<typename TToWrite>
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, const TToWrite& _val, char* _to_chars_buffer)
+    {
+        element* e = make_top(_node);
+        if (nullptr == e)
+            return;
 
-    void text(pugi::xml_node _node, double& _val) override
-    { _val = _node.text().as_double(); }
-    void text(pugi::xml_node _node, double& _val, const double def) override
-    { _val = _node.text().as_double(def); }
+        if (element_state::not_written == e->state)
+            write_start_tag_begin(*e);
 
-    void text(pugi::xml_node _node, bool& _val) override
-    { _val = _node.text().as_bool(); }
-    void text(pugi::xml_node _node, bool& _val, const bool def) override
-    { _val = _node.text().as_bool(def); }
+        if (element_state::start_tag_open == e->state)
+        {
+            write_attribute(*_out_str, _attrib_name, format(_val, _to_chars_buffer));
+            e->attributes_end = _flushed_size + _out_str->size();
+        }
+        else if (e->attributes_end >= _flushed_size)  // start tag was closed, but is still in _out_str
+        {
+            _late_attribute.clear();
+            write_attribute(_late_attribute, _attrib_name, format(_val, _to_chars_buffer));
+            _out_str->insert(e->attributes_end - _flushed_size, _late_attribute);
+            e->attributes_end += _late_attribute.size();
+        }
+        else
+            ++_out_of_order_count;
+    }
 
-    void text(pugi::xml_node _node, long long& _val) override
-    { _val = _node.text().as_llong(); }
-    void text(pugi::xml_node _node, long long& _val, const long long def) override
-    { _val = _node.text().as_llong(def); }
+private:
+    static constexpr size_t flush_size = 64 * 1024;
 
-    void text(pugi::xml_node _node, unsigned long long& _val) override
-    { _val = _node.text().as_ullong(); }
-    void text(pugi::xml_node _node, unsigned long long& _val, const unsigned long long def) override
-    { _val = _node.text().as_ullong(def); }
+    // same as pugixml's indent_newline, indent_indent
+    static constexpr unsigned int indent_newline = 1;
+    static constexpr unsigned int indent_indent = 2;
 
-    
-    void cdata(pugi::xml_node _node, std::string& _text) override
+    enum class element_state : uint8_t
     {
-        _text = _node.child_value();
-    }
+        not_written,        // nothing was written yet
+        start_tag_open,     // "<name" and maybe attributes were written
+        content             // start tag was closed
+    };
 
-    void attribute(pugi::xml_node _node, const char* _attrib_name, std::string& _text) override
+    struct element
     {
-        _text = _node.attribute(_attrib_name).as_string(_text.c_str());
-    }
-    
-    // return default_text if attribute does not exists
-    void attribute(pugi::xml_node _node, const char* _attrib_name, std::string& _text, std::string_view default_text) override
+        uintptr_t id = 0;
+        std::string name;
+        element_state state = element_state::not_written;
+        bool has_text = false;
+        bool text_written = false;
+        std::string text;
+        size_t attributes_end = 0;  // where the next attribute goes, counted from the beginning of the output
+    };
+
+    static uintptr_t to_id(pugi::xml_node _node) { return reinterpret_cast<uintptr_t>(_node.internal_object()); }
+    static pugi::xml_node to_node(const uintptr_t _id) { return pugi::xml_node(reinterpret_cast<pugi::xml_node_struct*>(_id)); }
+
+    // numbers are formatted the same as pugixml 1.11 or later: floats with %.9g, doubles with %.17g
+    template<typename TToWrite>
+    std::string_view format(const TToWrite& _val, char* _to_chars_buffer)
     {
-        if (auto attrib = _node.attribute(_attrib_name); attrib)
-            _text = attrib.as_string(_text.c_str());
+        if constexpr (std::is_same_v<TToWrite, bool>)
+            return _val ? "true" : "false";
+        else if constexpr (std::is_arithmetic_v<TToWrite>)
+        {
+            if constexpr (std::is_floating_point_v<TToWrite>)
+            {
+                if (nullptr == _to_chars_buffer)
+                {
+                    int len = std::snprintf(_number_buffer, sizeof(_number_buffer), "%.*g", std::is_same_v<TToWrite, float> ? 9 : 17, double(_val));
+                    return std::string_view(_number_buffer, static_cast<size_t>(len));
+                }
+            }
+            char* buffer = nullptr != _to_chars_buffer ? _to_chars_buffer : _number_buffer;
+            return std::string_view(buffer, format_number(_val, buffer));
+        }
         else
-            _text = default_text;
+            return std::string_view(_val);
     }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, int& _int) override
+
+    pugi::xml_node push(const char* _name)
     {
-        _int = _node.attribute(_attrib_name).as_int(_int);
+        if (_num_open == _elements.size())
+            _elements.emplace_back();
+        element& e = _elements[_num_open++];  // reused, so names and texts keep their allocations
+        e.id = ++_last_id;
+        e.name = _name;
+        e.state = element_state::not_written;
+        e.has_text = false;
+        e.text_written = false;
+        return to_node(e.id);
     }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, int& _int, const int def) override
+
+    // close the elements above _node, and return _node's element, which is now the top of the stack.
+    // return nullptr if _node is empty or already closed.
+    element* make_top(pugi::xml_node _node)
     {
-        _int = _node.attribute(_attrib_name).as_int(def);
+        const uintptr_t id = to_id(_node);
+        if (0 == id)
+            return nullptr;
+
+        size_t index = _num_open;
+        while (index > 0 && _elements[index - 1].id != id)
+            --index;
+        if (0 == index)
+        {
+            ++_out_of_order_count;
+            return nullptr;
+        }
+
+        while (_num_open > index)
+            close_top();
+        return &_elements[index - 1];
     }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned& _uint) override
+
+    void write_indent(const size_t _depth)
     {
-        _uint = _node.attribute(_attrib_name).as_uint(_uint);
+        if (0 != (_indent_flags & indent_newline) && !_raw)
+            _out_str->push_back('\n');
+        if (0 != (_indent_flags & indent_indent) && 0 != _indent_length)
+            for (size_t i = 0; i < _depth + _depth_offset; ++i)
+                _out_str->append(_indent_str, _indent_length);
     }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned& _uint, const unsigned def) override
+
+    void write_start_tag_begin(element& e)
     {
-        _uint = _node.attribute(_attrib_name).as_uint(def);
+        write_indent(static_cast<size_t>(&e - _elements.data()));
+        _out_str->push_back('<');
+        _out_str->append(e.name);
+        e.attributes_end = _flushed_size + _out_str->size();
+        e.state = element_state::start_tag_open;
+        _indent_flags = indent_newline | indent_indent;
     }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, float& _float) override
+
+    void close_start_tag(element& e)
     {
-        _float = _node.attribute(_attrib_name).as_float(_float);
+        if (element_state::not_written == e.state)
+            write_start_tag_begin(e);
+        if (element_state::start_tag_open == e.state)
+        {
+            _out_str->push_back('>');
+            if (e.has_text)
+            {
+                write_escaped(*_out_str, e.text, false);
+                e.text_written = true;
+                _indent_flags = 0;
+            }
+            e.state = element_state::content;
+        }
     }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, float& _float, const float def) override
+
+    void close_top()
     {
-        _float = _node.attribute(_attrib_name).as_float(def);
+        element& e = _elements[_num_open - 1];
+        if (element_state::not_written == e.state)
+            write_start_tag_begin(e);
+
+        if (element_state::start_tag_open == e.state)
+        {
+            if (e.has_text)
+            {
+                _out_str->push_back('>');
+                write_escaped(*_out_str, e.text, false);
+                write_end_tag(e);
+            }
+            else if (0 != (_format_flags & pugi::format_no_empty_element_tags))
+            {
+                _out_str->push_back('>');
+                write_end_tag(e);
+            }
+            else
+                _out_str->append(_raw ? "/>" : " />");
+        }
+        else
+        {
+            write_indent(_num_open - 1);
+            write_end_tag(e);
+        }
+        _indent_flags = indent_newline | indent_indent;
+        --_num_open;
+
+        if (_out_str->size() >= flush_size)
+            flush();
     }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, double& _double) override
+
+    void flush()
     {
-        _double = _node.attribute(_attrib_name).as_double(_double);
+        if (_flush_func)
+        {
+            _flush_func(*_out_str);
+            _flushed_size += _out_str->size();
+            _out_str->clear();
+        }
     }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, double& _double, const double def) override
+
+    void write_attribute(std::string& _out, const name_token& _attrib_name, const std::string_view _value)
     {
-        _double = _node.attribute(_attrib_name).as_double(def);
+        _out.push_back(' ');
+        _out.append(_attrib_name.c_str(), _attrib_name.length());
+        _out.append("=\"");
+        write_escaped(_out, _value, true);
+        _out.push_back('"');
     }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, bool& _bool) override
+
+    void write_end_tag(const element& e)
     {
-        _bool = _node.attribute(_attrib_name).as_bool(_bool);
+        _out_str->append("</");
+        _out_str->append(e.name);
+        _out_str->push_back('>');
     }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, bool& _bool, const bool def) override
+
+    // same escaping as pugixml:
+    // text: &, <, > and control characters except \t, \n, \r
+    // attribute: &, <, " and all control characters
+    void write_escaped(std::string& _out, const std::string_view _text, const bool _is_attribute)
     {
-        _bool = _node.attribute(_attrib_name).as_bool(def);
+        const char* s = _text.data();
+        const char* end = s + _text.size();
+        while (s != end)
+        {
+            const char* prev = s;
+            while (s != end && !needs_escape(static_cast<unsigned char>(*s), _is_attribute))
+                ++s;
+            _out.append(prev, static_cast<size_t>(s - prev));
+            if (s == end)
+                break;
+
+            const unsigned char ch = static_cast<unsigned char>(*s++);
+            switch (ch)
+            {
+                case '&': _out.append("&amp;"); break;
+                case '<': _out.append("&lt;"); break;
+                case '>': _out.append("&gt;"); break;
+                case '"': _out.append("&quot;"); break;
+                default:
+                {
+                    const char code[] = {'&', '#', static_cast<char>(ch / 10 + '0'), static_cast<char>(ch % 10 + '0'), ';'};
+                    _out.append(code, sizeof(code));
+                }
+                break;
+            }
+        }
     }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, long long& _llint) override
+
+    static bool needs_escape(const unsigned char ch, const bool _is_attribute)
     {
-        _llint = _node.attribute(_attrib_name).as_llong(_llint);
+        if (ch < 32)
+            return _is_attribute || (ch != '\t' && ch != '\n' && ch != '\r');
+        if (ch == '&' || ch == '<')
+            return true;
+        return _is_attribute ? ch == '"' : ch == '>';
     }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, long long& _llint, const long long def) override
+
+    std::string* _out_str = nullptr;
+    std::string _own_buffer;
+    size_t _flushed_size = 0;       // bytes passed to _flush_func and removed from _out_str
+    std::string _late_attribute;
+    std::function<void(const std::string&)> _flush_func;
+    const char* _indent_str = "";
+    size_t _indent_length = 0;
+    unsigned int _format_flags = 0;
+    bool _raw = false;
+    unsigned int _indent_flags = 0;
+
+    std::vector<element> _elements;
+    size_t _num_open = 0;
+    size_t _depth_offset = 0;       // depth of a fragment's root in the parent output
+    uintptr_t _last_id = 0;
+    size_t _out_of_order_count = 0;
+    char _number_buffer[to_chars_buffer_size];
+};
+
+// compact binary encoding used by binary_writer and binary_reader:
+//   header:    "PSB1", varint number of names, and for each name: varint length, bytes
+//   element:   tag::element, 4 bytes little-endian payload length, payload:
+//              varint name index, then attributes, text, cdata and child elements, in this order
+//   attribute: tag::attribute, varint name index, value
+//   text:      tag::text, value
+//   cdata:     tag::cdata, value
+//   value:     value_type, then: string: varint length, bytes and '\0'
+//                                numbers: raw little-endian, 4 or 8 bytes
+//                                bool: nothing, the value is in the type
+// Names of elements and attributes are written once in the header, and referred to by index.
+namespace binary_format
+{
+    constexpr char magic[] = {'P', 'S', 'B', '1'};
+
+    enum class tag : uint8_t
     {
-        _llint = _node.attribute(_attrib_name).as_llong(def);
-    }
-    
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned long long& _ullint) override
+        element = 1,
+        attribute = 2,
+        text = 3,
+        cdata = 4
+    };
+
+    enum class value_type : uint8_t
+    {
+        string_value = 0x10,
+        int32_value,
+        int64_value,
+        uint32_value,
+        uint64_value,
+        float_value,
+        double_value,
+        false_value,
+        true_value
+    };
+
+    inline void put_varint(std::string& _out, uint64_t _val)
     {
-        _ullint = _node.attribute(_attrib_name).as_ullong(_ullint);
+        while (_val >= 0x80)
+        {
+            _out.push_back(static_cast<char>((_val & 0x7f) | 0x80));
+            _val >>= 7;
+        }
+        _out.push_back(static_cast<char>(_val));
     }
-    void attribute(pugi::xml_node _node, const char* _attrib_name, unsigned long long& _ullint, const unsigned long long def) override
+
+    template<typename TUint>
+    void put_le(std::string& _out, const TUint _bits)
     {
-        _ullint = _node.attribute(_attrib_name).as_ullong(def);
+        for (size_t i = 0; i < sizeof(TUint); ++i)
+            _out.push_back(static_cast<char>((_bits >> (8 * i)) & 0xff));
     }
-};
-} // namespace impl
+
+    template<typename TUint>
+    TUint get_le(const unsigned char* _data)
+    {
+        TUint bits = 0;
+        for (size_t i = 0; i < sizeof(TUint); ++i)
+            bits |= static_cast<TUint>(_data[i]) << (8 * i);
+        return bits;
+    }
+
+    // return the number of bytes read, or 0 if the varint does not end before _end
+    inline size_t get_varint(const unsigned char* _data, const unsigned char* _end, uint64_t& _val)
+    {
+        _val = 0;
+        for (size_t i = 0; i < 10 && _data + i < _end; ++i)
+        {
+            _val |= static_cast<uint64_t>(_data[i] & 0x7f) << (7 * i);
+            if (0 == (_data[i] & 0x80))
+                return i + 1;
+        }
+        return 0;
+    }
+
+    template<typename TToWrite>
+    void put_value(std::string& _out, const TToWrite& _val)
+    {
+        if constexpr (std::is_same_v<TToWrite, bool>)
+            _out.push_back(static_cast<char>(_val ? value_type::true_value : value_type::false_value));
+        else if constexpr (std::is_same_v<TToWrite, float>)
+        {
+            _out.push_back(static_cast<char>(value_type::float_value));
+            put_le(_out, std::bit_cast<uint32_t>(_val));
+        }
+        else if constexpr (std::is_same_v<TToWrite, double>)
+        {
+            _out.push_back(static_cast<char>(value_type::double_value));
+            put_le(_out, std::bit_cast<uint64_t>(_val));
+        }
+        else if constexpr (std::is_integral_v<TToWrite> && std::is_signed_v<TToWrite>)
+        {
+            if constexpr (sizeof(TToWrite) <= 4)
+            {
+                _out.push_back(static_cast<char>(value_type::int32_value));
+                put_le(_out, static_cast<uint32_t>(_val));
+            }
+            else
+            {
+                _out.push_back(static_cast<char>(value_type::int64_value));
+                put_le(_out, static_cast<uint64_t>(_val));
+            }
+        }
+        else if constexpr (std::is_integral_v<TToWrite>)
+        {
+            if constexpr (sizeof(TToWrite) <= 4)
+            {
+                _out.push_back(static_cast<char>(value_type::uint32_value));
+                put_le(_out, static_cast<uint32_t>(_val));
+            }
+            else
+            {
+                _out.push_back(static_cast<char>(value_type::uint64_value));
+                put_le(_out, static_cast<uint64_t>(_val));
+            }
+        }
+        else
+        {
+            const std::string_view str(_val);
+            _out.push_back(static_cast<char>(value_type::string_value));
+            put_varint(_out, str.size());
+            _out.append(str);
+            _out.push_back('\0');
+        }
+    }
+
+    // return the size of the value at _data, or 0 if it's not a valid value or does not end before _end
+    inline size_t value_size(const unsigned char* _data, const unsigned char* _end)
+    {
+        if (_data >= _end)
+            return 0;
+        size_t payload_size = 0;
+        switch (static_cast<value_type>(_data[0]))
+        {
+            case value_type::string_value:
+            {
+                uint64_t length = 0;
+                const size_t length_size = get_varint(_data + 1, _end, length);
+                if (0 == length_size || length >= static_cast<uint64_t>(_end - _data))
+                    return 0;
+                payload_size = length_size + static_cast<size_t>(length) + 1;
+                if (payload_size >= static_cast<size_t>(_end - _data) || '\0' != _data[payload_size])
+                    return 0;
+            }
+            break;
+            case value_type::int32_value: case value_type::uint32_value: case value_type::float_value: payload_size = 4; break;
+            case value_type::int64_value: case value_type::uint64_value: case value_type::double_value: payload_size = 8; break;
+            case value_type::false_value: case value_type::true_value: payload_size = 0; break;
+            default: return 0;
+        }
+        return payload_size < static_cast<size_t>(_end - _data) ? payload_size + 1 : 0;
+    }
+}
+
+// writes the binary encoding, see binary_format.
+// Elements are kept in memory until finish(), so like a pugi::xml_document they can be written to in any order.
+// The pugi::xml_node objects passed to binary_output are not real nodes, but indices of the elements plus 1.
+class binary_output
+{
+public:
+    void start(std::string* _out, const char* doc_element_name)
+    {
+        _out_str = _out;
+        add_element(0, intern(doc_element_name));
+    }
+
+    // encode all elements and append them to the output
+    void finish()
+    {
+        if (nullptr == _out_str)
+            return;
+
+        _out_str->append(binary_format::magic, sizeof(binary_format::magic));
+        binary_format::put_varint(*_out_str, _names.size());
+        for (const std::string& name : _names)
+        {
+            binary_format::put_varint(*_out_str, name.size());
+            _out_str->append(name);
+        }
+        encode_element(0);
+        _out_str = nullptr;
+    }
+
+    pugi::xml_node root() { return to_node(0); }
+
+    void set_name(pugi::xml_node _node, const std::string& _name)
+    {
+        if (element* e = get_element(_node); nullptr != e)
+            e->name_id = intern(_name);
+    }
+
+    const char* name(pugi::xml_node _node)
+    {
+        element* e = get_element(_node);
+        return nullptr != e ? _names[e->name_id].c_str() : "";
+    }
+
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name)
+    {
+        element* parent = get_element(_node);
+        if (nullptr == parent)
+            return pugi::xml_node();
+        const uint32_t parent_index = static_cast<uint32_t>(parent - _elements.data());
+        const uint32_t child_index = add_element(parent_index + 1, intern(_name.view()));
+        element& parent_element = _elements[parent_index];   // add_element might have moved the elements
+        if (0 == parent_element.last_child)
+            parent_element.first_child = child_index + 1;
+        else
+            _elements[parent_element.last_child - 1].next_sibling = child_index + 1;
+        parent_element.last_child = child_index + 1;
+        return to_node(child_index);
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const name_token& _name)
+    {
+        element* older = get_element(older_sibling);
+        if (nullptr == older || 0 == older->parent)
+            return pugi::xml_node();
+        const uint32_t older_index = static_cast<uint32_t>(older - _elements.data());
+        const uint32_t younger_index = add_element(older->parent, intern(_name.view()));
+        element& older_element = _elements[older_index];
+        _elements[younger_index].next_sibling = older_element.next_sibling;
+        older_element.next_sibling = younger_index + 1;
+        element& parent_element = _elements[older_element.parent - 1];
+        if (parent_element.last_child == older_index + 1)
+            parent_element.last_child = younger_index + 1;
+        return to_node(younger_index);
+    }
+
+    template<typename TToWrite>
+    void text(pugi::xml_node _node, const TToWrite& _val, char*)
+    {
+        if (element* e = get_element(_node); nullptr != e)
+            e->text = add_value(_val);
+    }
+
+    void text(pugi::xml_node _node, const char* _c_str)
+    {
+        text(_node, std::string_view(_c_str), nullptr);
+    }
+
+    void cdata(pugi::xml_node _node, const std::string& _text)
+    {
+        if (element* e = get_element(_node); nullptr != e)
+            append_entry(e->cdata, 0, add_value(_text));
+    }
+
+    template<typename TToWrite>
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, const TToWrite& _val, char*)
+    {
+        if (element* e = get_element(_node); nullptr != e)
+            append_entry(e->attributes, intern(_attrib_name.view()), add_value(_val));
+    }
+
+    // a fragment is a separate tree, copied to the parent when done
+    pugi::xml_node start_fragment(binary_output&, pugi::xml_node)
+    {
+        add_element(0, intern(""));
+        return root();
+    }
+
+    void append_fragment(pugi::xml_node _parent_node, binary_output& _fragment)
+    {
+        for (uint32_t child = _fragment._elements[0].first_child; 0 != child; child = _fragment._elements[child - 1].next_sibling)
+            copy_element(_parent_node, _fragment, child - 1);
+    }
+
+private:
+    // a value encoded in _values
+    struct value_ref
+    {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // attribute or cdata, in a list per element
+    struct entry
+    {
+        uint32_t name_id = 0;
+        value_ref value;
+        uint32_t next = 0;          // index of the next entry plus 1, or 0
+    };
+
+    struct entry_list
+    {
+        uint32_t first = 0;         // index in _entries plus 1, or 0 if empty
+        uint32_t last = 0;
+    };
+
+    // links are indices plus 1, 0 when there is none
+    struct element
+    {
+        uint32_t name_id = 0;
+        uint32_t parent = 0;
+        uint32_t first_child = 0;
+        uint32_t last_child = 0;
+        uint32_t next_sibling = 0;
+        entry_list attributes;
+        entry_list cdata;
+        value_ref text;
+    };
+
+    struct string_hash
+    {
+        using is_transparent = void;
+        size_t operator()(const std::string_view _str) const { return std::hash<std::string_view>()(_str); }
+    };
+
+    static uintptr_t to_id(pugi::xml_node _node) { return reinterpret_cast<uintptr_t>(_node.internal_object()); }
+    static pugi::xml_node to_node(const uint32_t _index) { return pugi::xml_node(reinterpret_cast<pugi::xml_node_struct*>(uintptr_t(_index) + 1)); }
+
+    element* get_element(pugi::xml_node _node)
+    {
+        const uintptr_t id = to_id(_node);
+        return 0 != id && id <= _elements.size() ? &_elements[id - 1] : nullptr;
+    }
+
+    uint32_t intern(const std::string_view _name)
+    {
+        if (auto found = _name_ids.find(_name); found != _name_ids.end())
+            return found->second;
+        const uint32_t name_id = static_cast<uint32_t>(_names.size());
+        _names.emplace_back(_name);
+        _name_ids.emplace(_names.back(), name_id);
+        return name_id;
+    }
+
+    uint32_t add_element(const uint32_t _parent, const uint32_t _name_id)
+    {
+        element& e = _elements.emplace_back();
+        e.name_id = _name_id;
+        e.parent = _parent;
+        return static_cast<uint32_t>(_elements.size() - 1);
+    }
+
+    template<typename TToWrite>
+    value_ref add_value(const TToWrite& _val)
+    {
+        value_ref ref;
+        ref.offset = static_cast<uint32_t>(_values.size());
+        binary_format::put_value(_values, _val);
+        ref.size = static_cast<uint32_t>(_values.size() - ref.offset);
+        return ref;
+    }
+
+    value_ref copy_value(const binary_output& _from, const value_ref _value)
+    {
+        value_ref ref{static_cast<uint32_t>(_values.size()), _value.size};
+        _values.append(_from._values, _value.offset, _value.size);
+        return ref;
+    }
+
+    void append_entry(entry_list& _list, const uint32_t _name_id, const value_ref _value)
+    {
+        _entries.push_back(entry{_name_id, _value, 0});
+        const uint32_t entry_index = static_cast<uint32_t>(_entries.size());
+        if (0 == _list.last)
+            _list.first = entry_index;
+        else
+            _entries[_list.last - 1].next = entry_index;
+        _list.last = entry_index;
+    }
+
+    // copy _from's element _index and its subtree as the last child of _parent_node
+    void copy_element(pugi::xml_node _parent_node, const binary_output& _from, const uint32_t _index)
+    {
+        const element& from_element = _from._elements[_index];
+        pugi::xml_node new_node = child(_parent_node, name_token(_from._names[from_element.name_id].c_str()));
+        const uint32_t new_index = static_cast<uint32_t>(to_id(new_node) - 1);
+
+        for (uint32_t i = from_element.attributes.first; 0 != i; i = _from._entries[i - 1].next)
+        {
+            const uint32_t name_id = intern(_from._names[_from._entries[i - 1].name_id]);
+            append_entry(_elements[new_index].attributes, name_id, copy_value(_from, _from._entries[i - 1].value));
+        }
+        for (uint32_t i = from_element.cdata.first; 0 != i; i = _from._entries[i - 1].next)
+            append_entry(_elements[new_index].cdata, 0, copy_value(_from, _from._entries[i - 1].value));
+        if (0 != from_element.text.size)
+            _elements[new_index].text = copy_value(_from, from_element.text);
+
+        for (uint32_t child_index = from_element.first_child; 0 != child_index; child_index = _from._elements[child_index - 1].next_sibling)
+            copy_element(new_node, _from, child_index - 1);
+    }
+
+    void encode_element(const uint32_t _index)
+    {
+        const element& e = _elements[_index];
+        _out_str->push_back(static_cast<char>(binary_format::tag::element));
+        const size_t length_pos = _out_str->size();
+        binary_format::put_le(*_out_str, uint32_t(0));    // payload length, set when the payload was written
+        binary_format::put_varint(*_out_str, e.name_id);
+
+        for (uint32_t i = e.attributes.first; 0 != i; i = _entries[i - 1].next)
+        {
+            _out_str->push_back(static_cast<char>(binary_format::tag::attribute));
+            binary_format::put_varint(*_out_str, _entries[i - 1].name_id);
+            _out_str->append(_values, _entries[i - 1].value.offset, _entries[i - 1].value.size);
+        }
+        if (0 != e.text.size)
+        {
+            _out_str->push_back(static_cast<char>(binary_format::tag::text));
+            _out_str->append(_values, e.text.offset, e.text.size);
+        }
+        for (uint32_t i = e.cdata.first; 0 != i; i = _entries[i - 1].next)
+        {
+            _out_str->push_back(static_cast<char>(binary_format::tag::cdata));
+            _out_str->append(_values, _entries[i - 1].value.offset, _entries[i - 1].value.size);
+        }
+        for (uint32_t child_index = e.first_child; 0 != child_index; child_index = _elements[child_index - 1].next_sibling)
+            encode_element(child_index - 1);
+
+        const uint32_t payload_length = static_cast<uint32_t>(_out_str->size() - length_pos - 4);
+        for (size_t i = 0; i < 4; ++i)
+            (*_out_str)[length_pos + i] = static_cast<char>((payload_length >> (8 * i)) & 0xff);
+    }
+
+    std::string* _out_str = nullptr;
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, uint32_t, string_hash, std::equal_to<>> _name_ids;
+    std::vector<element> _elements;
+    std::vector<entry> _entries;
+    std::string _values;
+};
+
+// updates an existing tree instead of building a new one, see update_writer.
+// Elements are matched in order with the existing children of the same name, values are set only when they differ,
+// and what was not written again is removed by finish().
+class update_output
+{
+public:
+    update_output()
+    : _scratch(_scratch_doc.append_child("scratch"))
+    {}
+
+    // _root is the element being written
+    void start(pugi::xml_node _root)
+    {
+        _root_node = _root;
+        visit(_root);
+    }
+
+    // write _doc's document element, renamed or added if needed
+    void start(pugi::xml_document& _doc, const char* doc_element_name)
+    {
+        pugi::xml_node doc_element = _doc.document_element();
+        if (!doc_element)
+        {
+            doc_element = _doc.append_child(doc_element_name);
+            ++_stats.nodes_added;
+        }
+        else if (0 != std::strcmp(doc_element.name(), doc_element_name))
+        {
+            doc_element.set_name(doc_element_name);
+            ++_stats.values_changed;
+        }
+        start(doc_element);
+    }
+
+    pugi::xml_node root() const { return _root_node; }
+
+    // remove the elements, text, cdata and attributes under the root that were not written
+    void finish()
+    {
+        if (!_finished && _root_node)
+            sweep(_root_node);
+        _finished = true;
+    }
+
+    const update_stats& stats() const { return _stats; }
+
+    void set_name(pugi::xml_node _node, const std::string& _name)
+    {
+        if (_name != _node.name())
+        {
+            _node.set_name(_name.c_str());
+            ++_stats.values_changed;
+        }
+    }
+
+    const char* name(pugi::xml_node _node) { return _node.name(); }
+
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name)
+    {
+        pugi::xml_node& last_child = _last_children[_node.internal_object()];
+        pugi::xml_node found = find_unvisited_child(_node, last_child, _name);
+        if (!found)
+        {
+            found = last_child ? _node.insert_child_after(pugi::node_element, last_child) : _node.prepend_child(pugi::node_element);
+            found.set_name(_name.c_str());
+            ++_stats.nodes_added;
+        }
+        visit(found);
+        last_child = found;
+        return found;
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const name_token& _name)
+    {
+        pugi::xml_node parent = older_sibling.parent();
+        _last_children[parent.internal_object()] = older_sibling;
+        return child(parent, _name);
+    }
+
+    template<typename TToWrite>
+    void text(pugi::xml_node _node, const TToWrite& _val, char* _to_chars_buffer)
+    {
+        const std::string_view new_text = format(_val, _to_chars_buffer);
+        pugi::xml_text node_text = _node.text();
+        if (new_text != node_text.get())
+        {
+            node_text.set(new_text.data(), new_text.size());
+            ++_stats.values_changed;
+        }
+        visit(node_text.data());
+    }
+
+    void text(pugi::xml_node _node, const char* _c_str)
+    {
+        text(_node, std::string_view(_c_str), nullptr);
+    }
+
+    void cdata(pugi::xml_node _node, const std::string& _text)
+    {
+        pugi::xml_node cdata_node = _node.first_child();
+        while (cdata_node && (pugi::node_cdata != cdata_node.type() || is_visited(cdata_node)))
+            cdata_node = cdata_node.next_sibling();
+        if (!cdata_node)
+        {
+            cdata_node = _node.append_child(pugi::node_cdata);
+            ++_stats.nodes_added;
+        }
+        else if (_text != cdata_node.value())
+            ++_stats.values_changed;
+        else
+        {
+            visit(cdata_node);
+            return;
+        }
+        cdata_node.set_value(_text.c_str());
+        visit(cdata_node);
+    }
+
+    template<typename TToWrite>
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, const TToWrite& _val, char* _to_chars_buffer)
+    {
+        const std::string_view new_value = format(_val, _to_chars_buffer);
+        pugi::xml_attribute attrib = find_attribute(_node, _attrib_name);
+        if (!attrib)
+        {
+            attrib = _node.append_attribute(_attrib_name.c_str());
+            attrib.set_value(new_value.data(), new_value.size());
+            ++_stats.attributes_added;
+        }
+        else if (new_value != attrib.value())
+        {
+            attrib.set_value(new_value.data(), new_value.size());
+            ++_stats.values_changed;
+        }
+        _visited.insert(attrib.internal_object());
+    }
+
+    // not used, update_writer has no thread pool
+    pugi::xml_node start_fragment(update_output&, pugi::xml_node) { return pugi::xml_node(); }
+    void append_fragment(pugi::xml_node, update_output&) {}
+
+private:
+    // _val as it would be written by dom_output
+    template<typename TToWrite>
+    std::string_view format(const TToWrite& _val, char* _to_chars_buffer)
+    {
+        if constexpr (std::is_same_v<TToWrite, std::string> || std::is_same_v<TToWrite, std::string_view>)
+            return _val;
+        else
+        {
+            if constexpr (std::is_arithmetic_v<TToWrite> && !std::is_same_v<TToWrite, bool>)
+            {
+                if (nullptr != _to_chars_buffer)
+                    return std::string_view(_to_chars_buffer, format_number(_val, _to_chars_buffer));
+            }
+            write_text(_scratch, _val);
+            return _scratch.text().get();
+        }
+    }
+
+    // the first element named _name after _after that was not written yet, or else before _after
+    pugi::xml_node find_unvisited_child(pugi::xml_node _node, pugi::xml_node _after, const name_token& _name)
+    {
+        auto matches = [&](pugi::xml_node _child)
+        {
+            return pugi::node_element == _child.type() && _name.matches(_child.name()) && !is_visited(_child);
+        };
+        for (pugi::xml_node a_child = _after ? _after.next_sibling() : _node.first_child(); a_child; a_child = a_child.next_sibling())
+            if (matches(a_child))
+                return a_child;
+        if (_after)
+        {
+            for (pugi::xml_node a_child = _node.first_child(); a_child != _after; a_child = a_child.next_sibling())
+                if (matches(a_child))
+                    return a_child;
+        }
+        return pugi::xml_node();
+    }
+
+    void visit(pugi::xml_node _node)
+    {
+        if (_node)
+            _visited.insert(_node.internal_object());
+    }
+
+    bool is_visited(pugi::xml_node _node) const { return _visited.contains(_node.internal_object()); }
+
+    void sweep(pugi::xml_node _node)
+    {
+        for (pugi::xml_attribute attrib = _node.first_attribute(); attrib;)
+        {
+            pugi::xml_attribute next_attrib = attrib.next_attribute();
+            if (!_visited.contains(attrib.internal_object()))
+            {
+                _node.remove_attribute(attrib);
+                ++_stats.attributes_removed;
+            }
+            attrib = next_attrib;
+        }
+
+        for (pugi::xml_node a_child = _node.first_child(); a_child;)
+        {
+            pugi::xml_node next_child = a_child.next_sibling();
+            const pugi::xml_node_type type = a_child.type();
+            if (pugi::node_element == type || pugi::node_pcdata == type || pugi::node_cdata == type)
+            {
+                if (!is_visited(a_child))
+                {
+                    _node.remove_child(a_child);
+                    ++_stats.nodes_removed;
+                }
+                else if (pugi::node_element == type)
+                    sweep(a_child);
+            }
+            a_child = next_child;
+        }
+    }
+
+    pugi::xml_node _root_node;
+    std::unordered_set<const void*> _visited;   // elements, text, cdata and attributes written
+    std::unordered_map<const void*, pugi::xml_node> _last_children;  // last child written, by parent
+    update_stats _stats;
+    bool _finished = false;
+    pugi::xml_document _scratch_doc;    // numbers are formatted by pugixml in _scratch, to be compared
+    pugi::xml_node _scratch;
+};
+
+// the rules of what is written and what is skipped as default value, shared by all writers.
+// TOutput does the actual writing, see dom_output, stream_output
+template<typename TOutput>
+class basic_writer_impl : public impl_base
+{
+public:
+    TOutput _output;
+    bool _use_to_chars = false;
+    char _to_chars_buffer[to_chars_buffer_size];  // reused for every number written
+    thread_pool* _thread_pool = nullptr;
+    pugi::xml_node _fragment_root;
+    session_state* _session = nullptr;  // the session that owns this implementor, see writer(session&)
+
+    basic_writer_impl()
+    {
+        _reading = false;
+    }
+
+    // back to the settings of a new implementor, used by the next writer of a session
+    void reset_settings()
+    {
+        _write_default_values = true;
+        _observer = nullptr;
+        _tracer = nullptr;
+        _use_to_chars = false;
+        _thread_pool = nullptr;
+        _fragment_root = pugi::xml_node();
+    }
+
+    impl_base* new_fragment(pugi::xml_node _parent_node) override
+    {
+        auto* fragment_impl = new basic_writer_impl<TOutput>;
+        fragment_impl->_write_default_values = _write_default_values;
+        fragment_impl->_use_to_chars = _use_to_chars;
+        fragment_impl->_thread_pool = _thread_pool;
+        fragment_impl->_observer = _observer;
+        fragment_impl->_tracer = _tracer;
+        fragment_impl->_fragment_root = fragment_impl->_output.start_fragment(_output, _parent_node);
+        return fragment_impl;
+    }
+
+    pugi::xml_node fragment_root() override { return _fragment_root; }
+
+    void append_fragment(pugi::xml_node _parent_node, impl_base& _fragment_impl) override
+    {
+        _output.append_fragment(_parent_node, static_cast<basic_writer_impl<TOutput>&>(_fragment_impl)._output);
+    }
+
+    thread_pool* get_thread_pool() const override { return _thread_pool; }
+    bool has_document_nodes() const override { return !std::is_same_v<TOutput, stream_output> && !std::is_same_v<TOutput, binary_output>; }
+
+    // where numbers are formatted with std::to_chars, or nullptr to format numbers the same as pugixml
+    char* number_buffer() { return _use_to_chars ? _to_chars_buffer : nullptr; }
+
+    using impl_base::child;
+    
+    void node_name(pugi::xml_node _node, std::string& _name) override
+    {
+        _output.set_name(_node, _name);
+    }
+
+    const char* node_name(pugi::xml_node _node) override
+    {
+        return _output.name(_node);
+    }
+
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name) override
+    {
+        if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_child, _name.c_str(), false, 0);
+        return _output.child(_node, _name);
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const name_token& _name) override
+    {
+        if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_child, _name.c_str(), false, 0);
+        return _output.next_sibling(older_sibling, _name);
+    }
+
+    // nothing to iterate on when writing
+    pugi::xml_node first_child(pugi::xml_node) override
+    {
+        return pugi::xml_node();
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node) override
+    {
+        return pugi::xml_node();
+    }
+
+    void text(pugi::xml_node _node, std::string& _text) override
+    {
+        write_node_value(_node, _text);
+    }
+    
+    void text(pugi::xml_node _node, std::string& _text, std::string_view default_text) override
+    {
+        if (_text != default_text)
+        {
+            text(_node, _text);
+        }
+        else if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_text, _output.name(_node), true, 0);
+    }
+
+    void text(pugi::xml_node _node, std::string_view& _text) override
+    {
+        write_node_value(_node, _text);
+    }
+
+    void text(pugi::xml_node _node, std::string_view& _text, std::string_view default_text) override
+    {
+        if (_write_default_values || _text != default_text)
+            write_node_value(_node, _text);
+        else if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_text, _output.name(_node), true, 0);
+    }
+    
+    const char* c_str(pugi::xml_node _node, const char* _c_str) override
+    {
+        _output.text(_node, _c_str);
+        return _c_str;
+    }
+
+    template<typename TToWrite>
+    void write_node_value(pugi::xml_node _node, TToWrite& _val)
+    {
+        if constexpr (std::is_arithmetic_v<TToWrite>)
+            _output.text(_node, _val, number_buffer());
+        else
+            _output.text(_node, _val, nullptr);
+        if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_text, _output.name(_node), false, string_size(_val));
+    }
+    
+    template<typename TToWrite>
+    void write_node_value_with_default(pugi::xml_node _node, TToWrite& _val, const TToWrite def)
+    {
+        if (_write_default_values || def != _val)
+            write_node_value(_node, _val);
+        else if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_text, _output.name(_node), true, 0);
+    }
+
+    void text(pugi::xml_node _node, int& _val) override
+        { write_node_value(_node, _val); }
+    void text(pugi::xml_node _node, int& _val, const int def) override
+        { write_node_value_with_default(_node, _val, def); }
+    
+    void text(pugi::xml_node _node, unsigned& _val) override
+        { write_node_value(_node, _val); }
+    void text(pugi::xml_node _node, unsigned& _val, const unsigned def) override
+        { write_node_value_with_default(_node, _val, def); }
+    
+    void text(pugi::xml_node _node, float& _val) override
+        { write_node_value(_node, _val); }
+    void text(pugi::xml_node _node, float& _val, const float def) override
+        { write_node_value_with_default(_node, _val, def); }
+    
+    void text(pugi::xml_node _node, double& _val) override
+        { write_node_value(_node, _val); }
+    void text(pugi::xml_node _node, double& _val, const double def) override
+        { write_node_value_with_default(_node, _val, def); }
+    
+    void text(pugi::xml_node _node, bool& _val) override
+        { write_node_value(_node, _val); }
+    void text(pugi::xml_node _node, bool& _val, const bool def) override
+        { write_node_value_with_default(_node, _val, def); }
+    
+    void text(pugi::xml_node _node, long long& _val) override
+        { write_node_value(_node, _val); }
+    void text(pugi::xml_node _node, long long& _val, const long long def) override
+        { write_node_value_with_default(_node, _val, def); }
+    
+    void text(pugi::xml_node _node, unsigned long long& _val) override
+        { write_node_value(_node, _val); }
+    void text(pugi::xml_node _node, unsigned long long& _val, const unsigned long long def) override
+        { write_node_value_with_default(_node, _val, def); }
+    
+    void cdata(pugi::xml_node _node, std::string& _text) override
+    {
+        _output.cdata(_node, _text);
+    }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string& _text) override
+    {
+        write_attribute_value(_node, _attrib_name, _text);
+    }
+    
+    // do not append the attribute if _text is equal to default_text
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string& _text, std::string_view default_text) override
+    {
+        if (_write_default_values || _text != default_text)
+            write_attribute_value(_node, _attrib_name, _text);
+        else if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_attribute, _attrib_name.c_str(), true, 0);
+    }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string_view& _text) override
+    {
+        write_attribute_value(_node, _attrib_name, _text);
+    }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string_view& _text, std::string_view default_text) override
+    {
+        if (_write_default_values || _text != default_text)
+            write_attribute_value(_node, _attrib_name, _text);
+        else if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_attribute, _attrib_name.c_str(), true, 0);
+    }
+    
+    template<typename TToWrite>
+    void write_attribute_value(pugi::xml_node _node, const name_token& _attrib_name, TToWrite& _to_write)
+    {
+        if constexpr (std::is_arithmetic_v<TToWrite>)
+            _output.attribute(_node, _attrib_name, _to_write, number_buffer());
+        else
+            _output.attribute(_node, _attrib_name, _to_write, nullptr);
+        if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_attribute, _attrib_name.c_str(), false, string_size(_to_write));
+    }
+    
+    template<typename TToWrite>
+    void write_attribute_value_with_default(pugi::xml_node _node, const name_token& _attrib_name, TToWrite& _to_write, const TToWrite def)
+    // do not write the value if it's equal to the default
+    {
+        if (_write_default_values || _to_write != def)
+        {
+            write_attribute_value(_node, _attrib_name, _to_write);
+        }
+        else if (nullptr != _observer) [[unlikely]]
+            observe(&observer::on_attribute, _attrib_name.c_str(), true, 0);
+    }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, int& _val) override
+        { write_attribute_value(_node, _attrib_name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, int& _val, const int def) override
+        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+    
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned& _val) override
+        { write_attribute_value(_node, _attrib_name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned& _val, const unsigned def) override
+        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+    
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, float& _val) override
+        { write_attribute_value(_node, _attrib_name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, float& _val, const float def) override
+        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+    
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, double& _val) override
+        { write_attribute_value(_node, _attrib_name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, double& _val, const double def) override
+        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+    
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, bool& _val) override
+        { write_attribute_value(_node, _attrib_name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, bool& _val, const bool def) override
+        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+    
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, long long& _val) override
+        { write_attribute_value(_node, _attrib_name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, long long& _val, const long long def) override
+        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+    
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned long long& _val) override
+        { write_attribute_value(_node, _attrib_name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned long long& _val, const unsigned long long def) override
+        { write_attribute_value_with_default(_node, _attrib_name, _val, def); }
+
+private:
+    // only called when there is an observer
+    void observe(void (observer::*_on_call)(const observed_call&), const char* _name, const bool _default_used, const size_t _bytes_copied)
+    {
+        observed_call call;
+        call.name = _name;
+        call.default_used = _default_used;
+        call.bytes_copied = _bytes_copied;
+        (_observer->*_on_call)(call);
+    }
+};
+
+using writer_impl = basic_writer_impl<dom_output>;
+using stream_writer_impl = basic_writer_impl<stream_output>;
+using binary_writer_impl = basic_writer_impl<binary_output>;
+using update_writer_impl = basic_writer_impl<update_output>;
+
+// serialization plans, see reader::set_should_use_plans.
+// The attribute() and child() calls made on the first element with a given name are recorded, with the position
+// where each attribute or child was found. The calls on later elements with the same name are checked against
+// the plan: if a call has the same name as the planned call, the attribute or child at the planned position
+// is tried first, and only if its name does not match, the element is searched as usual. Positions found
+// that way shift the following planned positions, e.g. when an optional attribute is missing.
+// When a call has another name than the planned call, the plan is no longer used for that element.
+// Elements are tracked on a stack that follows the document's tree, so an element's place in the plan
+// is kept while its children are read.
+class plan_cache
+{
+public:
+    plan_stats _stats;
+
+    void clear()
+    {
+        _stats = plan_stats();
+        _plans.clear();
+        _cursors.clear();
+    }
+
+    pugi::xml_attribute attribute(pugi::xml_node _node, const name_token& _name)
+    {
+        cursor& c = cursor_for(_node);
+        const step* planned = next_step(c, false, _name);
+        if (nullptr != planned && no_position != planned->position)
+        {
+            pugi::xml_attribute attrib = attribute_at(c, int64_t(planned->position) + c.attribute_shift);
+            if (attrib && _name.matches(attrib.name()))
+            {
+                ++_stats.hits;
+                return attrib;
+            }
+            ++_stats.misses;
+        }
+
+        uint32_t position = 0;
+        pugi::xml_attribute attrib = _node.first_attribute();
+        while (attrib && !_name.matches(attrib.name()))
+        {
+            attrib = attrib.next_attribute();
+            ++position;
+        }
+
+        if (nullptr != planned && no_position != planned->position)
+        {
+            if (attrib)
+            {
+                c.attribute_shift = int64_t(position) - int64_t(planned->position);
+                c.last_attribute = attrib;
+                c.last_attribute_position = position;
+            }
+            else  // the planned attribute is missing, so the following attributes are probably one position earlier
+                --c.attribute_shift;
+        }
+        else if (is_recording(c))
+            c.a_plan->steps.push_back(step{false, _name.hash(), attrib ? position : no_position});
+        return attrib;
+    }
+
+    // the first child named _name, as with a normal lookup. With a plan, only the children after the last child
+    // returned for _node, up to the planned position, are compared, if none up to the last one can have that name.
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name)
+    {
+        cursor& c = cursor_for(_node);
+        const step* planned = next_step(c, true, _name);
+        if (nullptr != planned && no_position != planned->position)
+        {
+            const int64_t planned_position = int64_t(planned->position) + c.child_shift;
+            if (0 == (c.returned_names & name_bit(_name.hash())))
+            {
+                uint64_t names = c.returned_names;
+                int64_t position = c.returned_position + 1;
+                for (pugi::xml_node a_child = c.returned_child ? c.returned_child.next_sibling() : _node.first_child();
+                     a_child && position <= planned_position; a_child = a_child.next_sibling(), ++position)
+                {
+                    if (_name.matches(a_child.name()))
+                    {
+                        ++_stats.hits;
+                        c.child_shift = position - int64_t(planned->position);
+                        c.returned_child = a_child;
+                        c.returned_position = position;
+                        c.returned_names = names | name_bit(_name.hash());
+                        return a_child;
+                    }
+                    names |= name_bit(a_child.name());
+                }
+            }
+            ++_stats.misses;
+        }
+
+        uint32_t position = 0;
+        pugi::xml_node a_child = _node.first_child();
+        while (a_child && !_name.matches(a_child.name()))
+        {
+            a_child = a_child.next_sibling();
+            ++position;
+        }
+
+        if (a_child)
+            returned(c, a_child, position);
+        if (nullptr != planned && no_position != planned->position)
+        {
+            if (a_child)
+                c.child_shift = int64_t(position) - int64_t(planned->position);
+        }
+        else if (is_recording(c))
+            c.a_plan->steps.push_back(step{true, _name.hash(), a_child ? position : no_position});
+        return a_child;
+    }
+
+private:
+    static constexpr uint32_t no_position = ~uint32_t(0);   // the planned attribute or child was not found
+
+    struct step
+    {
+        bool is_child;
+        uint32_t name_hash;
+        uint32_t position;          // index among the element's attributes or child nodes
+    };
+
+    struct plan
+    {
+        std::vector<step> steps;
+        pugi::xml_node recording_node;  // the element whose calls are recorded
+        bool recorded = false;
+    };
+
+    struct cursor
+    {
+        pugi::xml_node node;
+        plan* a_plan = nullptr;
+        size_t next_step = 0;
+        bool diverged = false;
+        pugi::xml_attribute last_attribute;   // last attribute reached, and its position
+        uint32_t last_attribute_position = 0;
+        int64_t attribute_shift = 0;            // difference between actual and planned positions
+        pugi::xml_node returned_child;          // last child returned, the furthest one, and its position
+        int64_t returned_position = -1;
+        uint64_t returned_names = 0;            // name_bit of each child up to returned_child
+        int64_t child_shift = 0;
+    };
+
+    static uint64_t name_bit(const uint32_t _hash) { return uint64_t(1) << (_hash & 63); }
+    static uint64_t name_bit(const char* _name) { return name_bit(name_token::calc_hash(_name, std::strlen(_name))); }
+
+    // _child at _position was returned by a normal lookup, the names of the children up to it are added
+    static void returned(cursor& c, pugi::xml_node _child, const int64_t _position)
+    {
+        if (_position <= c.returned_position)
+            return;
+        for (pugi::xml_node a_child = c.returned_child ? c.returned_child.next_sibling() : c.node.first_child();
+             a_child != _child; a_child = a_child.next_sibling())
+            c.returned_names |= name_bit(a_child.name());
+        c.returned_names |= name_bit(_child.name());
+        c.returned_child = _child;
+        c.returned_position = _position;
+    }
+
+    bool is_recording(const cursor& c) const { return !c.a_plan->recorded && c.a_plan->recording_node == c.node; }
+
+    // the planned step for the current call, or nullptr if there is no plan or the call differs from the plan
+    const step* next_step(cursor& c, const bool _is_child, const name_token& _name)
+    {
+        if (!c.a_plan->recorded || c.diverged)
+            return nullptr;
+        if (c.next_step < c.a_plan->steps.size())
+        {
+            const step& planned = c.a_plan->steps[c.next_step++];
+            if (planned.is_child == _is_child && planned.name_hash == _name.hash())
+                return &planned;
+        }
+        c.diverged = true;
+        ++_stats.misses;
+        return nullptr;
+    }
+
+    cursor& cursor_for(pugi::xml_node _node)
+    {
+        for (size_t i = _cursors.size(); i > 0; --i)
+        {
+            if (_cursors[i - 1].node == _node)
+            {
+                _cursors.resize(i);     // elements above _node were done
+                return _cursors.back();
+            }
+        }
+
+        const pugi::xml_node parent = _node.parent();
+        while (!_cursors.empty() && _cursors.back().node != parent)
+            _cursors.pop_back();
+
+        cursor& c = _cursors.emplace_back();
+        c.node = _node;
+        c.a_plan = &_plans[_node.name()];
+        if (!c.a_plan->recorded)
+        {
+            if (!c.a_plan->recording_node)
+                c.a_plan->recording_node = _node;
+            else if (c.a_plan->recording_node != _node)   // the recorded element is done, since another one was started
+            {
+                c.a_plan->recorded = true;
+                ++_stats.plans_recorded;
+            }
+        }
+        return c;
+    }
+
+    pugi::xml_attribute attribute_at(cursor& c, const int64_t _position)
+    {
+        if (_position < 0)
+            return pugi::xml_attribute();
+        if (!c.last_attribute || c.last_attribute_position > _position)
+        {
+            c.last_attribute = c.node.first_attribute();
+            c.last_attribute_position = 0;
+        }
+        while (c.last_attribute && c.last_attribute_position < _position)
+        {
+            c.last_attribute = c.last_attribute.next_attribute();
+            ++c.last_attribute_position;
+        }
+        return c.last_attribute;
+    }
+
+    std::unordered_map<std::string, plan> _plans;   // by element name
+    std::vector<cursor> _cursors;
+};
+
+class reader_impl : public impl_base
+{
+public:
+    bool _use_ordered_lookup = false;
+    lookup_stats _lookup_stats;
+    bool _use_from_chars = false;
+    std::vector<number_parse_error> _parse_errors;
+    std::shared_ptr<pugi::xml_document> _doc;  // keeps std::string_view values valid, see reader(std::shared_ptr<pugi::xml_document>)
+    thread_pool* _thread_pool = nullptr;
+    bool _use_plans = false;
+    plan_cache _plans;
+    std::mutex _merge_mutex;    // task_readers on different threads may merge their results at the same time
+    session_state* _session = nullptr;  // the session whose document is read, and that owns this implementor unless it's a task_reader's, see reader(session&)
+    std::shared_ptr<const reader_settings> _shared_settings;   // see share_settings
+
+    // back to the settings and results of a new implementor, used by the next reader of a session.
+    // Containers are cleared, so they keep their capacity
+    void reset_settings()
+    {
+        _write_default_values = true;
+        _observer = nullptr;
+        _tracer = nullptr;
+        _use_ordered_lookup = false;
+        _lookup_stats = lookup_stats();
+        _use_from_chars = false;
+        _parse_errors.clear();
+        _thread_pool = nullptr;
+        _use_plans = false;
+        _plans.clear();
+        _memory_resource = nullptr;
+        _id_index = nullptr;
+        _shared_settings.reset();
+    }
+
+    impl_base* clone_settings() const override
+    {
+        auto* task_impl = new reader_impl;
+        task_impl->_write_default_values = _write_default_values;
+        task_impl->_use_ordered_lookup = _use_ordered_lookup;
+        task_impl->_use_from_chars = _use_from_chars;
+        task_impl->_thread_pool = _thread_pool;
+        task_impl->_use_plans = _use_plans;
+        task_impl->_observer = _observer;
+        task_impl->_tracer = _tracer;
+        task_impl->_memory_resource = _memory_resource;
+        task_impl->_id_index = _id_index;
+        task_impl->_doc = _doc;
+        task_impl->_session = _session;
+        return task_impl;
+    }
+
+    // true if _other has the settings copied by clone_settings
+    bool same_settings(const reader_impl& _other) const
+    {
+        return _write_default_values == _other._write_default_values && _use_ordered_lookup == _other._use_ordered_lookup
+            && _use_from_chars == _other._use_from_chars && _thread_pool == _other._thread_pool && _use_plans == _other._use_plans
+            && _observer == _other._observer && _tracer == _other._tracer && _memory_resource == _other._memory_resource
+            && _id_index == _other._id_index && _doc == _other._doc;
+    }
+
+    std::shared_ptr<const reader_settings> share_settings() override
+    {
+        if (nullptr != _session)
+            return nullptr;
+        if (nullptr == _shared_settings || !same_settings(static_cast<const reader_impl&>(*_shared_settings->_settings)))
+            _shared_settings = std::make_shared<const reader_settings>(clone_settings());
+        return _shared_settings;
+    }
+
+    void merge_results(impl_base& _task_impl) override
+    {
+        auto& task_impl = static_cast<reader_impl&>(_task_impl);
+        std::lock_guard<std::mutex> lock(_merge_mutex);
+        _lookup_stats.cursor_hits += task_impl._lookup_stats.cursor_hits;
+        _lookup_stats.cursor_misses += task_impl._lookup_stats.cursor_misses;
+        _plans._stats.plans_recorded += task_impl._plans._stats.plans_recorded;
+        _plans._stats.hits += task_impl._plans._stats.hits;
+        _plans._stats.misses += task_impl._plans._stats.misses;
+        _parse_errors.insert(_parse_errors.end(), task_impl._parse_errors.begin(), task_impl._parse_errors.end());
+    }
+
+    thread_pool* get_thread_pool() const override { return _thread_pool; }
+    std::shared_ptr<pugi::xml_document> document() const override { return _doc; }
+    
+    // where from_chars parse errors are recorded, or nullptr to parse numbers with pugixml
+    std::vector<number_parse_error>* number_errors() { return _use_from_chars ? &_parse_errors : nullptr; }
+
+    void node_name(pugi::xml_node _node, std::string& _name) override
+    {
+        _name = _node.name();
+    }
+
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name) override
+    {
+        if (nullptr != _observer) [[unlikely]]
+            return observed_child(_node, _name, nullptr);
+        if (_use_plans)
+            return _plans.child(_node, _name);
+        return find_child(_node, _name);
+    }
+
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name, pugi::xml_node& _last_child) override
+    {
+        if (nullptr != _observer) [[unlikely]]
+            return observed_child(_node, _name, &_last_child);
+        if (_use_plans)
+            return _last_child = _plans.child(_node, _name);
+        else if (_use_ordered_lookup)
+            return find_child_ordered(_node, _name, _last_child, _lookup_stats);
+        else
+            return find_child(_node, _name);
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const name_token& _name) override
+    {
+        pugi::xml_node younger_sibling = find_next_sibling(older_sibling, _name);
+        if (nullptr != _observer) [[unlikely]]
+        {
+            observed_call call;
+            call.name = _name.c_str();
+            call.scanned = count_scanned(older_sibling.next_sibling(), younger_sibling);
+            call.found = younger_sibling;
+            _observer->on_child(call);
+        }
+        return younger_sibling;
+    }
+
+    pugi::xml_node first_child(pugi::xml_node _node) override
+    {
+        return first_element_child(_node);
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling) override
+    {
+        return next_element_sibling(older_sibling);
+    }
+    
+    const char* c_str(pugi::xml_node _node, const char*) override
+    {
+        return _node.text().as_string();
+    }
+
+    void text(pugi::xml_node _node, std::string& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, std::string& _val, std::string_view default_text) override
+        { read_text_with_default(_node, _val, default_text, number_errors()); }
+
+    void text(pugi::xml_node _node, std::string_view& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, std::string_view& _val, std::string_view default_text) override
+        { read_text_with_default(_node, _val, default_text, number_errors()); }
+
+    void text(pugi::xml_node _node, int& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, int& _val, const int def) override
+        { read_text_with_default(_node, _val, def, number_errors()); }
+
+    void text(pugi::xml_node _node, unsigned& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, unsigned& _val, const unsigned def) override
+        { read_text_with_default(_node, _val, def, number_errors()); }
+
+    void text(pugi::xml_node _node, float& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, float& _val, const float def) override
+        { read_text_with_default(_node, _val, def, number_errors()); }
+
+    void text(pugi::xml_node _node, double& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, double& _val, const double def) override
+        { read_text_with_default(_node, _val, def, number_errors()); }
+
+    void text(pugi::xml_node _node, bool& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, bool& _val, const bool def) override
+        { read_text_with_default(_node, _val, def, number_errors()); }
+
+    void text(pugi::xml_node _node, long long& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, long long& _val, const long long def) override
+        { read_text_with_default(_node, _val, def, number_errors()); }
+
+    void text(pugi::xml_node _node, unsigned long long& _val) override
+        { read_text(_node, _val, number_errors()); }
+    void text(pugi::xml_node _node, unsigned long long& _val, const unsigned long long def) override
+        { read_text_with_default(_node, _val, def, number_errors()); }
+
+    void cdata(pugi::xml_node _node, std::string& _text) override
+    {
+        _text = _node.child_value();
+    }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string& _val, std::string_view default_text) override
+        { read_attribute_with_default(_node, _attrib_name, _val, default_text, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string_view& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, std::string_view& _val, std::string_view default_text) override
+        { read_attribute_with_default(_node, _attrib_name, _val, default_text, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, int& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, int& _val, const int def) override
+        { read_attribute_with_default(_node, _attrib_name, _val, def, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned& _val, const unsigned def) override
+        { read_attribute_with_default(_node, _attrib_name, _val, def, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, float& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, float& _val, const float def) override
+        { read_attribute_with_default(_node, _attrib_name, _val, def, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, double& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, double& _val, const double def) override
+        { read_attribute_with_default(_node, _attrib_name, _val, def, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, bool& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, bool& _val, const bool def) override
+        { read_attribute_with_default(_node, _attrib_name, _val, def, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, long long& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, long long& _val, const long long def) override
+        { read_attribute_with_default(_node, _attrib_name, _val, def, number_errors()); }
+
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned long long& _val) override
+        { read_attribute(_node, _attrib_name, _val, number_errors()); }
+    void attribute(pugi::xml_node _node, const name_token& _attrib_name, unsigned long long& _val, const unsigned long long def) override
+        { read_attribute_with_default(_node, _attrib_name, _val, def, number_errors()); }
+
+    void attributes(pugi::xml_node _node, const attribute_binding* _bindings, const size_t _num_bindings) override
+    {
+        if (nullptr != _observer) [[unlikely]]
+            impl_base::attributes(_node, _bindings, _num_bindings);  // one by one, so each is observed
+        else
+            read_attributes(_node, _bindings, _num_bindings, number_errors());
+    }
+
+private:
+    // same as child(), and notify the observer. a cursor or plan hit compared one name,
+    // a miss compared one name and then searched from the first child.
+    pugi::xml_node observed_child(pugi::xml_node _node, const name_token& _name, pugi::xml_node* _last_child)
+    {
+        const size_t hits_before = _lookup_stats.cursor_hits + _plans._stats.hits;
+        bool tried_candidate = false;
+        pugi::xml_node found;
+        if (_use_plans)
+        {
+            found = _plans.child(_node, _name);
+            if (nullptr != _last_child)
+                *_last_child = found;
+            tried_candidate = true;
+        }
+        else if (nullptr != _last_child && _use_ordered_lookup)
+        {
+            found = find_child_ordered(_node, _name, *_last_child, _lookup_stats);
+            tried_candidate = true;
+        }
+        else
+            found = find_child(_node, _name);
+
+        observed_call call;
+        call.name = _name.c_str();
+        call.found = found;
+        if (_lookup_stats.cursor_hits + _plans._stats.hits != hits_before)
+            call.scanned = 1;
+        else
+            call.scanned = (tried_candidate ? 1 : 0) + count_scanned(_node.first_child(), found);
+        _observer->on_child(call);
+        return found;
+    }
+
+    template<typename TToRead>
+    void observe_attribute(pugi::xml_node _node, const name_token& _attrib_name, pugi::xml_attribute _attrib,
+                           const size_t _plan_hits_before, const bool _default_used, const TToRead& _val)
+    {
+        observed_call call;
+        call.name = _attrib_name.c_str();
+        call.found = _attrib;
+        if (_plans._stats.hits != _plan_hits_before)
+            call.scanned = 1;
+        else
+            call.scanned = (_use_plans ? 1 : 0) + count_scanned(_node.first_attribute(), _attrib);
+        call.default_used = _default_used;
+        if constexpr (std::is_same_v<TToRead, std::string>)
+            call.bytes_copied = _attrib ? _val.size() : 0;
+        _observer->on_attribute(call);
+    }
+
+    // same as impl::read_text, impl::read_text_with_default, and notify the observer
+    template<typename TToRead>
+    void read_text(pugi::xml_node _node, TToRead& _val, std::vector<number_parse_error>* _errors)
+    {
+        impl::read_text(_node, _val, _errors);
+        if (nullptr != _observer) [[unlikely]]
+            observe_text(_node, false, _val);
+    }
+
+    template<typename TToRead, typename TDefault>
+    void read_text_with_default(pugi::xml_node _node, TToRead& _val, const TDefault def, std::vector<number_parse_error>* _errors)
+    {
+        impl::read_text_with_default(_node, _val, def, _errors);
+        if (nullptr != _observer) [[unlikely]]
+            observe_text(_node, !_node.text(), _val);
+    }
+
+    template<typename TToRead>
+    void observe_text(pugi::xml_node _node, const bool _default_used, const TToRead& _val)
+    {
+        observed_call call;
+        call.name = _node.name();
+        call.found = _node.text();
+        call.default_used = _default_used;
+        if constexpr (std::is_same_v<TToRead, std::string>)
+            call.bytes_copied = call.found ? _val.size() : 0;
+        _observer->on_text(call);
+    }
+
+    // same as impl::read_attribute, impl::read_attribute_with_default, but the attribute is found with the plans if used
+    pugi::xml_attribute lookup_attribute(pugi::xml_node _node, const name_token& _attrib_name)
+    {
+        if (_use_plans)
+            return _plans.attribute(_node, _attrib_name);
+        return find_attribute(_node, _attrib_name);
+    }
+
+    template<typename TToRead>
+    void read_attribute(pugi::xml_node _node, const name_token& _attrib_name, TToRead& _val, std::vector<number_parse_error>* _errors)
+    {
+        const size_t plan_hits_before = _plans._stats.hits;
+        auto attrib = lookup_attribute(_node, _attrib_name);
+        if (attrib)
+            read_value(attrib, _val, attrib.name(), _errors);
+        if (nullptr != _observer) [[unlikely]]
+            observe_attribute(_node, _attrib_name, attrib, plan_hits_before, false, _val);
+    }
+
+    template<typename TToRead, typename TDefault>
+    void read_attribute_with_default(pugi::xml_node _node, const name_token& _attrib_name, TToRead& _val, const TDefault def, std::vector<number_parse_error>* _errors)
+    {
+        const size_t plan_hits_before = _plans._stats.hits;
+        auto attrib = lookup_attribute(_node, _attrib_name);
+        if (attrib)
+            read_value(attrib, _val, attrib.name(), _errors);
+        else
+            _val = def;
+        if (nullptr != _observer) [[unlikely]]
+            observe_attribute(_node, _attrib_name, attrib, plan_hits_before, !attrib, _val);
+    }
+};
+
+// reads the binary encoding written by binary_output, see binary_format.
+// The encoding is decoded once into an index of the elements, values are read from the encoding when requested.
+// The pugi::xml_node objects passed to binary_reader_impl are not real nodes, but indices of the elements plus 1.
+class binary_reader_impl : public impl_base
+{
+public:
+    pugi::xml_parse_status _status = pugi::status_ok;
+
+    binary_reader_impl(const unsigned char* _data, const size_t _size)
+    : _data(_data)
+    {
+        _status = decode(_data + _size);
+    }
+
+    pugi::xml_node root() { return pugi::status_ok == _status ? to_node(0) : pugi::xml_node(); }
+
+    bool has_document_nodes() const override { return false; }
+
+    void node_name(pugi::xml_node _node, std::string& _name) override
+    {
+        _name = node_name(_node);
+    }
+
+    const char* node_name(pugi::xml_node _node) override
+    {
+        return _names[get_element(_node).name_id].c_str();
+    }
+
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name) override
+    {
+        return find_element(get_element(_node).first_child, _name);
+    }
+
+    // same as reader's ordered lookup: try the sibling after _last_child first,
+    // but only if no earlier sibling has the same name, so the result is the same as child()
+    pugi::xml_node child(pugi::xml_node _node, const name_token& _name, pugi::xml_node& _last_child) override
+    {
+        const uint32_t candidate = _last_child ? get_element(_last_child).next_sibling : get_element(_node).first_child;
+        if (0 != candidate && !_elements[candidate - 1].repeated_name && name_matches(_elements[candidate - 1], _name))
+            _last_child = to_node(candidate - 1);
+        else if (pugi::xml_node found = child(_node, _name); found)
+            _last_child = found;
+        else
+            return pugi::xml_node();
+        return _last_child;
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling, const name_token& _name) override
+    {
+        return find_element(get_element(older_sibling).next_sibling, _name);
+    }
+
+    pugi::xml_node first_child(pugi::xml_node _node) override
+    {
+        const uint32_t first = get_element(_node).first_child;
+        return 0 != first ? to_node(first - 1) : pugi::xml_node();
+    }
+
+    pugi::xml_node next_sibling(pugi::xml_node older_sibling) override
+    {
+        const uint32_t next = get_element(older_sibling).next_sibling;
+        return 0 != next ? to_node(next - 1) : pugi::xml_node();
+    }
+
+    const char* c_str(pugi::xml_node _node, const char*) override
+    {
+        const uint32_t text = get_element(_node).text;
+        if (0 != text && binary_format::value_type::string_value == static_cast<binary_format::value_type>(_data[text - 1]))
+            return string_at(text - 1).data();
+        return "";
+    }
+
+    void text(pugi::xml_node _node, std::string& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, std::string& _val, std::string_view def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, std::string_view& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, std::string_view& _val, std::string_view def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, int& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, int& _val, const int def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, unsigned& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, unsigned& _val, const unsigned def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, float& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, float& _val, const float def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, double& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, double& _val, const double def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, bool& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, bool& _val, const bool def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, long long& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, long long& _val, const long long def) override { read_text_with_default(_node, _val, def); }
+    void text(pugi::xml_node _node, unsigned long long& _val) override { read_text(_node, _val); }
+    void text(pugi::xml_node _node, unsigned long long& _val, const unsigned long long def) override { read_text_with_default(_node, _val, def); }
+
+    // same as reader: the first cdata, or the text if there is no cdata
+    void cdata(pugi::xml_node _node, std::string& _text) override
+    {
+        const element& e = get_element(_node);
+        const uint32_t value = 0 != e.cdata ? e.cdata : e.text;
+        if (0 != value)
+            read_value(value - 1, _text);
+        else
+            _text.clear();
+    }
+
+    void attribute(pugi::xml_node _node, const name_token& _name, std::string& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, std::string& _val, std::string_view def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, std::string_view& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, std::string_view& _val, std::string_view def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, int& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, int& _val, const int def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, unsigned& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, unsigned& _val, const unsigned def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, float& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, float& _val, const float def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, double& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, double& _val, const double def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, bool& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, bool& _val, const bool def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, long long& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, long long& _val, const long long def) override { read_attribute_with_default(_node, _name, _val, def); }
+    void attribute(pugi::xml_node _node, const name_token& _name, unsigned long long& _val) override { read_attribute(_node, _name, _val); }
+    void attribute(pugi::xml_node _node, const name_token& _name, unsigned long long& _val, const unsigned long long def) override { read_attribute_with_default(_node, _name, _val, def); }
+
+private:
+    static constexpr size_t max_depth = 1024;
+
+    // links and values are indices/offsets plus 1, 0 when there is none
+    struct element
+    {
+        uint32_t name_id = 0;
+        uint32_t first_child = 0;
+        uint32_t next_sibling = 0;
+        uint32_t first_attribute = 0;   // index in _attributes
+        uint32_t num_attributes = 0;
+        uint32_t text = 0;              // offset of the value in _data
+        uint32_t cdata = 0;
+        bool repeated_name = false;     // an earlier sibling has the same name
+    };
+
+    struct attribute_entry
+    {
+        uint32_t name_id;
+        uint32_t value;                 // offset of the value in _data
+    };
+
+    static uintptr_t to_id(pugi::xml_node _node) { return reinterpret_cast<uintptr_t>(_node.internal_object()); }
+    static pugi::xml_node to_node(const uint32_t _index) { return pugi::xml_node(reinterpret_cast<pugi::xml_node_struct*>(uintptr_t(_index) + 1)); }
+
+    // empty nodes are mapped to an element with no children and no values
+    const element& get_element(pugi::xml_node _node) const
+    {
+        const uintptr_t id = to_id(_node);
+        return 0 != id && id <= _elements.size() ? _elements[id - 1] : _empty_element;
+    }
+
+    bool name_matches(const element& e, const name_token& _name) const
+    {
+        return _name_hashes[e.name_id] == _name.hash() && _names[e.name_id] == _name.view();
+    }
+
+    pugi::xml_node find_element(uint32_t _first, const name_token& _name) const
+    {
+        while (0 != _first && !name_matches(_elements[_first - 1], _name))
+            _first = _elements[_first - 1].next_sibling;
+        return 0 != _first ? to_node(_first - 1) : pugi::xml_node();
+    }
+
+    // offset of the attribute's value plus 1, or 0 if the element has no such attribute
+    uint32_t find_attribute(pugi::xml_node _node, const name_token& _name) const
+    {
+        const element& e = get_element(_node);
+        for (uint32_t i = e.first_attribute; i < e.first_attribute + e.num_attributes; ++i)
+        {
+            const uint32_t name_id = _attributes[i].name_id;
+            if (_name_hashes[name_id] == _name.hash() && _names[name_id] == _name.view())
+                return _attributes[i].value + 1;
+        }
+        return 0;
+    }
+
+    std::string_view string_at(const uint32_t _offset) const
+    {
+        uint64_t length = 0;
+        const size_t length_size = binary_format::get_varint(_data + _offset + 1, _data + _offset + 11, length);
+        return std::string_view(reinterpret_cast<const char*>(_data + _offset + 1 + length_size), static_cast<size_t>(length));
+    }
+
+    // read the value at _offset into _val, converting between numbers and strings if the types differ
+    template<typename TToRead>
+    void read_value(const uint32_t _offset, TToRead& _val)
+    {
+        using binary_format::value_type;
+        const unsigned char* payload = _data + _offset + 1;
+        switch (static_cast<value_type>(_data[_offset]))
+        {
+            case value_type::string_value: read_string(string_at(_offset), _val); break;
+            case value_type::int32_value: read_number(static_cast<int32_t>(binary_format::get_le<uint32_t>(payload)), _val); break;
+            case value_type::int64_value: read_number(static_cast<int64_t>(binary_format::get_le<uint64_t>(payload)), _val); break;
+            case value_type::uint32_value: read_number(binary_format::get_le<uint32_t>(payload), _val); break;
+            case value_type::uint64_value: read_number(binary_format::get_le<uint64_t>(payload), _val); break;
+            case value_type::float_value: read_number(std::bit_cast<float>(binary_format::get_le<uint32_t>(payload)), _val); break;
+            case value_type::double_value: read_number(std::bit_cast<double>(binary_format::get_le<uint64_t>(payload)), _val); break;
+            case value_type::false_value: read_number(false, _val); break;
+            case value_type::true_value: read_number(true, _val); break;
+        }
+    }
+
+    template<typename TToRead>
+    void read_string(const std::string_view _str, TToRead& _val)
+    {
+        if constexpr (std::is_same_v<TToRead, std::string> || std::is_same_v<TToRead, std::string_view>)
+            _val = _str;
+        else if constexpr (std::is_same_v<TToRead, bool>)
+            _val = !_str.empty() && (_str[0] == '1' || _str[0] == 't' || _str[0] == 'T' || _str[0] == 'y' || _str[0] == 'Y');   // same as pugixml
+        else
+        {
+            parse_number("", _str.data(), _val, _conversion_errors);   // the string ends with '\0'
+            _conversion_errors.clear();
+        }
+    }
+
+    template<typename TNumber, typename TToRead>
+    void read_number(const TNumber _number, TToRead& _val)
+    {
+        if constexpr (std::is_same_v<TToRead, std::string> || std::is_same_v<TToRead, std::string_view>)
+        {
+            // a view needs a string that remains valid
+            std::string& converted = _converted_strings.emplace_back();
+            if constexpr (std::is_same_v<TNumber, bool>)
+                converted = _number ? "true" : "false";
+            else
+            {
+                char buffer[to_chars_buffer_size];
+                converted.assign(buffer, format_number(_number, buffer));
+            }
+            _val = converted;
+        }
+        else
+            _val = static_cast<TToRead>(_number);
+    }
+
+    template<typename TToRead>
+    void read_text(pugi::xml_node _node, TToRead& _val)
+    // missing text is read as empty string or 0
+    {
+        if (const uint32_t text = get_element(_node).text; 0 != text)
+            read_value(text - 1, _val);
+        else
+            _val = TToRead();
+    }
+
+    template<typename TToRead, typename TDefault>
+    void read_text_with_default(pugi::xml_node _node, TToRead& _val, const TDefault def)
+    {
+        if (const uint32_t text = get_element(_node).text; 0 != text)
+            read_value(text - 1, _val);
+        else
+            _val = def;
+    }
+
+    template<typename TToRead>
+    void read_attribute(pugi::xml_node _node, const name_token& _name, TToRead& _val)
+    // leave _val unchanged if attribute does not exists
+    {
+        if (const uint32_t value = find_attribute(_node, _name); 0 != value)
+            read_value(value - 1, _val);
+    }
+
+    template<typename TToRead, typename TDefault>
+    void read_attribute_with_default(pugi::xml_node _node, const name_token& _name, TToRead& _val, const TDefault def)
+    {
+        if (const uint32_t value = find_attribute(_node, _name); 0 != value)
+            read_value(value - 1, _val);
+        else
+            _val = def;
+    }
+
+    pugi::xml_parse_status decode(const unsigned char* _end)
+    {
+        const unsigned char* pos = _data;
+        if (static_cast<size_t>(_end - pos) < sizeof(binary_format::magic) || 0 != std::memcmp(pos, binary_format::magic, sizeof(binary_format::magic)))
+            return pugi::status_unrecognized_tag;
+        pos += sizeof(binary_format::magic);
+
+        uint64_t num_names = 0;
+        size_t varint_size = binary_format::get_varint(pos, _end, num_names);
+        if (0 == varint_size || num_names > static_cast<uint64_t>(_end - pos))
+            return pugi::status_unrecognized_tag;
+        pos += varint_size;
+        _names.reserve(static_cast<size_t>(num_names));
+        for (uint64_t i = 0; i < num_names; ++i)
+        {
+            uint64_t length = 0;
+            varint_size = binary_format::get_varint(pos, _end, length);
+            if (0 == varint_size || length > static_cast<uint64_t>(_end - pos - varint_size))
+                return pugi::status_unrecognized_tag;
+            pos += varint_size;
+            _names.emplace_back(reinterpret_cast<const char*>(pos), static_cast<size_t>(length));
+            _name_hashes.push_back(name_token::calc_hash(_names.back().data(), _names.back().size()));
+            pos += length;
+        }
+
+        const pugi::xml_parse_status status = decode_element(pos, _end, 0, 0);
+        _child_names = std::unordered_set<uint64_t>();
+        return status;
+    }
+
+    // decode the element at _pos, and link it as the last child of _parent (index plus 1, 0 for the root)
+    pugi::xml_parse_status decode_element(const unsigned char*& _pos, const unsigned char* _end, const uint32_t _parent, const size_t _depth)
+    {
+        if (_depth > max_depth || _end - _pos < 5 || binary_format::tag::element != static_cast<binary_format::tag>(*_pos))
+            return pugi::status_bad_start_element;
+        const uint32_t payload_length = binary_format::get_le<uint32_t>(_pos + 1);
+        _pos += 5;
+        if (payload_length > static_cast<size_t>(_end - _pos))
+            return pugi::status_bad_start_element;
+        const unsigned char* payload_end = _pos + payload_length;
+
+        uint64_t name_id = 0;
+        size_t varint_size = binary_format::get_varint(_pos, payload_end, name_id);
+        if (0 == varint_size || name_id >= _names.size())
+            return pugi::status_bad_start_element;
+        _pos += varint_size;
+
+        const uint32_t index = static_cast<uint32_t>(_elements.size());
+        _elements.emplace_back().name_id = static_cast<uint32_t>(name_id);
+        _elements[index].first_attribute = static_cast<uint32_t>(_attributes.size());
+        if (0 != _parent)
+        {
+            if (0 == _elements[_parent - 1].first_child)
+                _elements[_parent - 1].first_child = index + 1;
+            else
+                _elements[_last_children[_parent - 1] - 1].next_sibling = index + 1;
+            _last_children[_parent - 1] = index + 1;
+            _elements[index].repeated_name = !_child_names.insert((uint64_t(_parent) << 32) | name_id).second;
+        }
+        _last_children.push_back(0);
+
+        while (_pos < payload_end)
+        {
+            const auto entry_tag = static_cast<binary_format::tag>(*_pos);
+            if (binary_format::tag::element == entry_tag)
+            {
+                if (const auto child_status = decode_element(_pos, payload_end, index + 1, _depth + 1); pugi::status_ok != child_status)
+                    return child_status;
+                continue;
+            }
+
+            ++_pos;
+            pugi::xml_parse_status entry_status = pugi::status_ok;
+            if (binary_format::tag::attribute == entry_tag)
+            {
+                varint_size = binary_format::get_varint(_pos, payload_end, name_id);
+                if (0 == varint_size || name_id >= _names.size() || 0 != _elements[index].first_child)  // attributes come before children
+                    return pugi::status_bad_attribute;
+                _pos += varint_size;
+                _attributes.push_back(attribute_entry{static_cast<uint32_t>(name_id), static_cast<uint32_t>(_pos - _data)});
+                ++_elements[index].num_attributes;
+                entry_status = pugi::status_bad_attribute;
+            }
+            else if (binary_format::tag::text == entry_tag)
+            {
+                _elements[index].text = static_cast<uint32_t>(_pos - _data) + 1;
+                entry_status = pugi::status_bad_pcdata;
+            }
+            else if (binary_format::tag::cdata == entry_tag)
+            {
+                if (0 == _elements[index].cdata)
+                    _elements[index].cdata = static_cast<uint32_t>(_pos - _data) + 1;
+                entry_status = pugi::status_bad_cdata;
+            }
+            else
+                return pugi::status_bad_start_element;
+
+            const size_t size = binary_format::value_size(_pos, payload_end);
+            if (0 == size)
+                return entry_status;
+            _pos += size;
+        }
+        return pugi::status_ok;
+    }
+
+    const unsigned char* _data;
+    std::vector<std::string> _names;
+    std::vector<uint32_t> _name_hashes;
+    std::vector<element> _elements;
+    std::vector<uint32_t> _last_children;   // per element, used while decoding
+    std::unordered_set<uint64_t> _child_names;  // parent and name of each element, used while decoding
+    std::vector<attribute_entry> _attributes;
+    element _empty_element;
+    std::deque<std::string> _converted_strings;
+    std::vector<number_parse_error> _conversion_errors;    // not reported, strings that are not numbers are read as 0
+};
+
+// finds the root element and its child elements in xml text that is read in chunks,
+// so only one child element at a time has to be in memory
+class item_scanner
+{
+public:
+    item_scanner(std::istream* _in, const char* _data, const size_t _size, const unsigned int _parse_options)
+    : _input(_in)
+    , _input_done(nullptr == _in)
+    , _parse_options(_parse_options)
+    {
+        if (nullptr == _input)
+            _text = std::string_view(_data, _size);
+        scan_root();
+    }
+
+    pugi::xml_node root() const { return _root_doc.document_element(); }
+    pugi::xml_parse_status status() const { return _status; }
+
+    pugi::xml_node next_item()
+    {
+        _item_doc.reset();
+        if (pugi::status_ok != _status || _root_ended)
+            return pugi::xml_node();
+
+        // skip text, comments and processing instructions between the root's children
+        size_t item_start = 0;
+        while (true)
+        {
+            size_t token_start = _text.find('<', _pos);
+            if (std::string_view::npos == token_start)
+            {
+                _pos = _text.size();
+                if (!read_more())
+                    return fail(pugi::status_end_element_mismatch);
+                continue;
+            }
+            _pos = token_start;
+
+            size_t token_end = find_token_end(_pos);
+            if (std::string_view::npos == token_end)
+            {
+                if (!read_more())
+                    return fail(pugi::status_end_element_mismatch);
+                continue;
+            }
+
+            token_type type = type_of(_pos, token_end);
+            if (token_type::end_tag == type)
+            {
+                _root_ended = true;
+                _pos = token_end;
+                return pugi::xml_node();
+            }
+            if (token_type::start_tag == type || token_type::empty_element_tag == type)
+            {
+                item_start = _pos;
+                break;
+            }
+            _pos = token_end;
+        }
+
+        // find the end of the item, reading more input as needed
+        size_t depth = 0;
+        while (true)
+        {
+            size_t token_start = _text.find('<', _pos);
+            size_t token_end = std::string_view::npos == token_start ? token_start : find_token_end(token_start);
+            if (std::string_view::npos == token_end)
+            {
+                if (std::string_view::npos == token_start)
+                    _pos = _text.size();
+                else
+                    _pos = token_start;
+                if (!read_more(&item_start))
+                    return fail(pugi::status_end_element_mismatch);
+                continue;
+            }
+
+            token_type type = type_of(token_start, token_end);
+            _pos = token_end;
+            if (token_type::start_tag == type)
+                ++depth;
+            else if (token_type::end_tag == type)
+                --depth;
+            if (0 == depth && (token_type::start_tag == type || token_type::end_tag == type || token_type::empty_element_tag == type))
+                break;
+        }
+
+        // the item is parsed in place when it's in _buffer, which is not needed anymore after parsing
+        pugi::xml_parse_result result;
+        if (nullptr != _input)
+            result = _item_doc.load_buffer_inplace(&_buffer[item_start], _pos - item_start, _parse_options, pugi::encoding_utf8);
+        else
+            result = _item_doc.load_buffer(_text.data() + item_start, _pos - item_start, _parse_options, pugi::encoding_utf8);
+        if (pugi::status_ok != result.status)
+            return fail(result.status);
+        return _item_doc.document_element();
+    }
+
+private:
+    static constexpr size_t chunk_size = 64 * 1024;
+
+    enum class token_type { start_tag, end_tag, empty_element_tag, other };
+
+    pugi::xml_node fail(const pugi::xml_parse_status _fail_status)
+    {
+        _status = _fail_status;
+        _item_doc.reset();
+        return pugi::xml_node();
+    }
+
+    // skip the xml declaration, comments and doctype, and parse the root's start tag into _root_doc
+    void scan_root()
+    {
+        while (true)
+        {
+            size_t token_start = _text.find('<', _pos);
+            size_t token_end = std::string_view::npos == token_start ? token_start : find_token_end(token_start);
+            if (std::string_view::npos == token_end)
+            {
+                if (std::string_view::npos == token_start)
+                    _pos = _text.size();
+                else
+                    _pos = token_start;
+                if (!read_more())
+                {
+                    _status = pugi::status_no_document_element;
+                    return;
+                }
+                continue;
+            }
+
+            token_type type = type_of(token_start, token_end);
+            _pos = token_end;
+            if (token_type::start_tag == type || token_type::empty_element_tag == type)
+            {
+                // parse the start tag as an empty element, to get the root's name and attributes
+                std::string root_tag(_text.substr(token_start, token_end - token_start));
+                if (token_type::start_tag == type)
+                    root_tag.insert(root_tag.size() - 1, "/");
+                pugi::xml_parse_result result = _root_doc.load_buffer(root_tag.data(), root_tag.size(), _parse_options, pugi::encoding_utf8);
+                _status = result.status;
+                _root_ended = token_type::empty_element_tag == type;
+                return;
+            }
+            if (token_type::end_tag == type)
+            {
+                _status = pugi::status_no_document_element;
+                return;
+            }
+        }
+    }
+
+    // append the next chunk of input to _buffer, dropping what was already scanned, except from *_keep_from.
+    // return false if there is nothing more to read, and the end of input was already known the last time
+    bool read_more(size_t* _keep_from = nullptr)
+    {
+        if (_input_done)
+            return false;
+
+        size_t drop = nullptr != _keep_from ? *_keep_from : _pos;
+        _buffer.erase(0, drop);
+        _pos -= drop;
+        if (nullptr != _keep_from)
+            *_keep_from = 0;
+
+        size_t old_size = _buffer.size();
+        _buffer.resize(old_size + chunk_size);
+        _input->read(&_buffer[old_size], static_cast<std::streamsize>(chunk_size));
+        size_t num_read = static_cast<size_t>(_input->gcount());
+        _buffer.resize(old_size + num_read);
+        _text = _buffer;
+        _input_done = num_read < chunk_size;
+        return true;
+    }
+
+    // _start is the position of a '<', return the position after the token's end, or npos if the token is not complete.
+    // attribute values may contain '>', and so may comments, cdata, processing instructions and doctype
+    size_t find_token_end(const size_t _start) const
+    {
+        std::string_view rest = _text.substr(_start);
+        auto end_of = [&](std::string_view _terminator, size_t _from) -> size_t
+        {
+            size_t found = rest.find(_terminator, _from);
+            return std::string_view::npos == found ? found : _start + found + _terminator.size();
+        };
+
+        if (rest.size() < 9 && !_input_done)  // might be a partial "<![CDATA["
+            return std::string_view::npos;
+        if (rest.starts_with("<!--"))
+            return end_of("-->", 4);
+        if (rest.starts_with("<![CDATA["))
+            return end_of("]]>", 9);
+        if (rest.starts_with("<?"))
+            return end_of("?>", 2);
+
+        // tags, and <!DOCTYPE which may have an internal subset in []
+        char quote = 0;
+        int bracket_depth = 0;
+        for (size_t i = 1; i < rest.size(); ++i)
+        {
+            const char c = rest[i];
+            if (0 != quote)
+            {
+                if (c == quote)
+                    quote = 0;
+            }
+            else if (c == '"' || c == '\'')
+                quote = c;
+            else if (c == '[')
+                ++bracket_depth;
+            else if (c == ']')
+                --bracket_depth;
+            else if (c == '>' && bracket_depth <= 0)
+                return _start + i + 1;
+        }
+        return std::string_view::npos;
+    }
+
+    token_type type_of(const size_t _start, const size_t _end) const
+    {
+        const char second = _text[_start + 1];
+        if (second == '/')
+            return token_type::end_tag;
+        if (second == '!' || second == '?')
+            return token_type::other;
+        if (_text[_end - 2] == '/')
+            return token_type::empty_element_tag;
+        return token_type::start_tag;
+    }
+
+    std::istream* _input = nullptr;     // nullptr when reading from a buffer
+    bool _input_done;                   // all input was read into _buffer
+    unsigned int _parse_options;
+    std::string _buffer;                // input read so far and not dropped yet
+    std::string_view _text;             // _buffer, or the whole buffer when not reading from _input
+    size_t _pos = 0;                    // scanning position in _text
+    bool _root_ended = false;
+    pugi::xml_parse_status _status = pugi::status_ok;
+    pugi::xml_document _root_doc;
+    pugi::xml_document _item_doc;
+};
+// the queues and threads of a thread_pool
+class pool_state
+{
+public:
+    // the tasks of one parallel_for call
+    struct batch
+    {
+        const std::function<void(size_t)>* func;
+        std::atomic<size_t> num_remaining;      // tasks that did not finish yet
+        std::atomic<bool> failed{false};        // once a task threw, the other tasks do not call func
+        std::mutex exception_mutex;
+        std::exception_ptr first_exception;     // rethrown by parallel_for when all tasks finished
+    };
+
+    struct task
+    {
+        batch* owner;
+        size_t index;
+    };
+
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    explicit pool_state(const unsigned int num_threads)
+    : _queues(num_threads)
+    {
+        for (auto& queue : _queues)
+            queue = std::make_unique<task_queue>();
+        _threads.reserve(num_threads);
+        for (unsigned int i = 0; i < num_threads; ++i)
+            _threads.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~pool_state()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_wake_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& a_thread : _threads)
+            a_thread.join();
+    }
+
+    unsigned int size() const { return static_cast<unsigned int>(_threads.size()); }
+
+    void parallel_for(const size_t _count, const std::function<void(size_t)>& _func)
+    {
+        if (_threads.empty() || _count < 2)
+        {
+            for (size_t i = 0; i < _count; ++i)
+                _func(i);
+            return;
+        }
+
+        // tasks go to the calling worker's own queue, where other workers will find them when they are idle
+        batch the_batch;
+        the_batch.func = &_func;
+        the_batch.num_remaining.store(_count, std::memory_order_relaxed);
+        const size_t queue_index = this == tls_pool ? tls_queue_index : _next_queue++ % _queues.size();
+        {
+            task_queue& queue = *_queues[queue_index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (size_t i = 0; i < _count; ++i)
+                queue.tasks.push_back(task{&the_batch, i});
+        }
+        {
+            std::lock_guard<std::mutex> lock(_wake_mutex);
+            _num_queued += _count;
+        }
+        _wake.notify_all();
+
+        // help while waiting, this also runs the tasks of nested parallel_for calls
+        while (the_batch.num_remaining.load(std::memory_order_acquire) > 0)
+        {
+            task a_task;
+            if (take_task(queue_index, a_task))
+                run(a_task);
+            else
+                std::this_thread::yield();
+        }
+        if (the_batch.first_exception)
+            std::rethrow_exception(the_batch.first_exception);
+    }
+
+private:
+    void worker_loop(const size_t _queue_index)
+    {
+        tls_pool = this;
+        tls_queue_index = _queue_index;
+        while (true)
+        {
+            task a_task;
+            if (take_task(_queue_index, a_task))
+            {
+                run(a_task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_wake_mutex);
+            _wake.wait(lock, [this] { return _stop || _num_queued > 0; });
+            if (_stop)
+                return;
+        }
+    }
+
+    // newest task from own queue, or oldest task from another queue
+    bool take_task(const size_t _queue_index, task& _task)
+    {
+        for (size_t i = 0; i < _queues.size(); ++i)
+        {
+            const bool own_queue = 0 == i;
+            task_queue& queue = *_queues[(_queue_index + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+            if (own_queue)
+            {
+                _task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                _task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            std::lock_guard<std::mutex> wake_lock(_wake_mutex);
+            --_num_queued;
+            return true;
+        }
+        return false;
+    }
+
+    // an exception is kept for the caller of parallel_for, so the worker goes on and the batch is always finished
+    static void run(const task& _task)
+    {
+        batch& owner = *_task.owner;
+        if (!owner.failed.load(std::memory_order_relaxed))
+        {
+            try
+            {
+                (*owner.func)(_task.index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(owner.exception_mutex);
+                if (!owner.first_exception)
+                    owner.first_exception = std::current_exception();
+                owner.failed.store(true, std::memory_order_relaxed);
+            }
+        }
+        owner.num_remaining.fetch_sub(1, std::memory_order_release);
+    }
+
+    static thread_local pool_state* tls_pool;     // pool of the current thread, if it's a worker
+    static thread_local size_t tls_queue_index;
+
+    std::vector<std::unique_ptr<task_queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::atomic<size_t> _next_queue{0};
+    std::mutex _wake_mutex;
+    std::condition_variable _wake;
+    size_t _num_queued = 0;
+    bool _stop = false;
+};
+
+thread_local pool_state* pool_state::tls_pool = nullptr;
+thread_local size_t pool_state::tls_queue_index = 0;
+
+} // namespace impl
+
+thread_pool::thread_pool(const unsigned int num_threads)
+: _state(new impl::pool_state(0 != num_threads ? num_threads : std::max(1u, std::thread::hardware_concurrency())))
+{}
+
+thread_pool::~thread_pool()
+{
+    delete _state;
+}
+
+unsigned int thread_pool::size() const
+{
+    return _state->size();
+}
+
+void thread_pool::parallel_for(const size_t _count, const std::function<void(size_t)>& _func)
+{
+    _state->parallel_for(_count, _func);
+}
+
+namespace impl
+{
+    // small numbers for the threads, in the order they first write a span
+    static int trace_thread_id()
+    {
+        static std::atomic<int> next_thread_id{1};
+        thread_local int thread_id = next_thread_id++;
+        return thread_id;
+    }
+
+    static void write_json_string(std::ostream& _out, std::string_view _str)
+    {
+        _out << '"';
+        for (char c : _str)
+        {
+            if ('"' == c || '\\' == c)
+                _out << '\\' << c;
+            else if (static_cast<unsigned char>(c) >= 0x20)
+                _out << c;
+        }
+        _out << '"';
+    }
+
+    static int64_t steady_now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+trace_writer::trace_writer(std::ostream& _out, const double _min_item_us)
+: _out(_out)
+, _min_item_us(_min_item_us)
+, _origin_ns(impl::steady_now_ns())
+{
+    _out << "{\"traceEvents\":[";
+}
+
+trace_writer::~trace_writer()
+{
+    finish();
+}
+
+void trace_writer::finish()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_finished)
+    {
+        _out << "\n]}\n";
+        _out.flush();
+        _finished = true;
+    }
+}
+
+int64_t trace_writer::now_us() const
+{
+    return (impl::steady_now_ns() - _origin_ns) / 1000;
+}
+
+void trace_writer::complete(const char* _name, const char* _category, const int64_t _start_us, std::string_view _args)
+{
+    const int64_t end_us = now_us();
+    const int thread_id = impl::trace_thread_id();
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_finished)
+        return;
+    _out << (_first_event ? "\n" : ",\n");
+    _first_event = false;
+    _out << "{\"name\":";
+    impl::write_json_string(_out, _name);
+    _out << ",\"cat\":";
+    impl::write_json_string(_out, _category);
+    _out << ",\"ph\":\"X\",\"ts\":" << _start_us << ",\"dur\":" << end_us - _start_us << ",\"pid\":1,\"tid\":" << thread_id;
+    if (!_args.empty())
+        _out << ",\"args\":{" << _args << '}';
+    _out << '}';
+}
+
+void trace_writer::end_container(const char* _item_name, const int64_t _start_us, const size_t _num_items)
+{
+    complete(_item_name, "serialize_container", _start_us, "\"count\":" + std::to_string(_num_items));
+}
+
+void trace_writer::end_item(const char* _item_name, const int64_t _start_us, const size_t _index)
+{
+    if (static_cast<double>(now_us() - _start_us) >= _min_item_us)
+        complete(_item_name, "item", _start_us, "\"index\":" + std::to_string(_index));
+}
+
+trace_span::trace_span(trace_writer* _tracer, const char* _name, const char* _category)
+: _tracer(_tracer)
+, _name(_name)
+, _category(_category)
+{
+    if (nullptr != _tracer)
+        _start_us = _tracer->now_us();
+}
+
+trace_span::~trace_span()
+{
+    if (nullptr != _tracer)
+        _tracer->complete(_name, _category, _start_us);
+}
+
+void counting_observer::add(std::map<std::string, counters, std::less<>>& _counters, const observed_call& _call)
+{
+    auto found = _counters.find(std::string_view(_call.name));
+    if (_counters.end() == found)
+        found = _counters.emplace(_call.name, counters()).first;
+    counters& name_counters = found->second;
+    ++name_counters.calls;
+    name_counters.scanned += _call.scanned;
+    name_counters.misses += _call.found ? 0 : 1;
+    name_counters.defaults += _call.default_used ? 1 : 0;
+    name_counters.bytes_copied += _call.bytes_copied;
+}
+
+void counting_observer::on_child(const observed_call& _call)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    add(_elements, _call);
+}
+
+void counting_observer::on_attribute(const observed_call& _call)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    add(_attributes, _call);
+}
+
+void counting_observer::on_text(const observed_call& _call)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    add(_elements, _call);
+}
+
+std::map<std::string, counting_observer::counters, std::less<>> counting_observer::elements() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _elements;
+}
+
+std::map<std::string, counting_observer::counters, std::less<>> counting_observer::attributes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _attributes;
+}
+
+counting_observer::counters counting_observer::total() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    counters sum;
+    for (const auto* name_counters : {&_elements, &_attributes})
+    {
+        for (const auto& [name, a_counters] : *name_counters)
+        {
+            sum.calls += a_counters.calls;
+            sum.scanned += a_counters.scanned;
+            sum.misses += a_counters.misses;
+            sum.defaults += a_counters.defaults;
+            sum.bytes_copied += a_counters.bytes_copied;
+        }
+    }
+    return sum;
+}
+
+void counting_observer::reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _elements.clear();
+    _attributes.clear();
+}
+
+bool id_index::add(const std::string& _id, void* _object, const std::type_info& _type)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const bool added = _objects.try_emplace(_id, indexed_object{_object, &_type}).second;
+    if (!added)
+        ++_duplicates;
+    return added;
+}
+
+void* id_index::find(const std::string_view _id, const std::type_info& _type) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _objects.find(_id);
+    if (found == _objects.end() || *found->second.type != _type)
+        return nullptr;
+    return found->second.object;
+}
+
+void id_index::add_ref(const std::string& _id, void*& _target, const std::type_info& _type)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _refs.push_back(pending_ref{&_id, &_target, &_type});
+}
+
+size_t id_index::resolve()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t num_unresolved = 0;
+    for (const pending_ref& a_ref : _refs)
+    {
+        auto found = _objects.find(*a_ref.id);
+        if (found != _objects.end() && *found->second.type == *a_ref.type)
+            *a_ref.target = found->second.object;
+        else
+            ++num_unresolved;
+    }
+    _refs.clear();
+    return num_unresolved;
+}
+
+size_t id_index::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _objects.size();
+}
+
+size_t id_index::duplicates() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _duplicates;
+}
+
+void id_index::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _objects.clear();
+    _refs.clear();
+    _duplicates = 0;
+}
+
+namespace impl
+{
+    // pugixml's memory functions before session::install_memory_functions replaced them, also used for the blocks of the arenas
+    static pugi::allocation_function previous_allocate = nullptr;
+    static pugi::deallocation_function previous_deallocate = nullptr;
+
+    // blocks of memory handed out in order, for the pages of a session's document.
+    // Memory is not freed block by block: rewind() starts again from the first block.
+    class arena
+    {
+    public:
+        arena(const size_t _first_block_size, const bool _use_huge_pages)
+        : _first_block_size(std::max<size_t>(_first_block_size, 4096))
+        , _use_huge_pages(_use_huge_pages)
+        {}
+
+        ~arena();
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        void* allocate(const size_t _size)
+        {
+            const size_t size = (_size + alignment - 1) & ~(alignment - 1);
+            for (; _current < _blocks.size(); ++_current, _used = 0)
+            {
+                const block& a_block = _blocks[_current];
+                if (a_block.size - _used >= size)
+                {
+                    void* memory = a_block.data + _used;
+                    _used += size;
+                    return memory;
+                }
+            }
+
+            const size_t block_size = std::max(size, _blocks.empty() ? _first_block_size : _blocks.back().size * 2);
+            if (!add_block(block_size))
+                return nullptr;
+            _used = size;
+            return _blocks.back().data;
+        }
+
+        void rewind()
+        {
+            _current = 0;
+            _used = 0;
+        }
+
+        size_t capacity() const
+        {
+            size_t total = 0;
+            for (const block& a_block : _blocks)
+                total += a_block.size;
+            return total;
+        }
+
+        size_t used() const
+        {
+            size_t total = _used;
+            for (size_t i = 0; i < _current && i < _blocks.size(); ++i)
+                total += _blocks[i].size;
+            return total;
+        }
+
+    private:
+        static constexpr size_t alignment = alignof(std::max_align_t);
+
+        struct block
+        {
+            char* data = nullptr;
+            size_t size = 0;
+            bool mapped = false;
+        };
+
+        bool add_block(size_t _size);
+
+        static void free_block(const block& _block)
+        {
+#ifndef _WIN32
+            if (_block.mapped)
+            {
+                ::munmap(_block.data, _block.size);
+                return;
+            }
+#endif
+            previous_deallocate(_block.data);
+        }
+
+        const size_t _first_block_size;
+        const bool _use_huge_pages;
+        std::vector<block> _blocks;
+        size_t _current = 0;    // block being allocated from
+        size_t _used = 0;       // bytes allocated from the current block
+    };
+
+    arena::~arena()
+    {
+        for (const block& a_block : _blocks)
+            free_block(a_block);
+    }
+
+    bool arena::add_block(size_t _size)
+    {
+        block new_block;
+#ifndef _WIN32
+        if (_use_huge_pages)
+        {
+            const size_t huge_page_size = 2 * 1024 * 1024;
+            _size = (_size + huge_page_size - 1) & ~(huge_page_size - 1);
+            void* mapping = MAP_FAILED;
+#ifdef MAP_HUGETLB
+            mapping = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+            if (MAP_FAILED == mapping)
+            {
+                // no reserved huge pages, ask for transparent huge pages instead
+                mapping = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+                if (MAP_FAILED != mapping)
+                    ::madvise(mapping, _size, MADV_HUGEPAGE);
+#endif
+            }
+            if (MAP_FAILED != mapping)
+            {
+                new_block.data = static_cast<char*>(mapping);
+                new_block.mapped = true;
+            }
+        }
+#endif
+        if (nullptr == new_block.data)
+            new_block.data = static_cast<char*>(previous_allocate(_size));
+        if (nullptr == new_block.data)
+            return false;
+        new_block.size = _size;
+        _blocks.push_back(new_block);
+        _current = _blocks.size() - 1;
+        return true;
+    }
+
+    // each allocation made through pugixml once the session functions are installed starts with a header,
+    // so deallocating tells arena memory from other memory without searching the arenas
+    struct alignas(std::max_align_t) allocation_header
+    {
+        bool from_arena;
+    };
+
+    static void* session_allocate(size_t _size)
+    {
+        char* memory = nullptr;
+        bool from_arena = false;
+        if (nullptr != active_arena)
+        {
+            memory = static_cast<char*>(active_arena->allocate(sizeof(allocation_header) + _size));
+            from_arena = nullptr != memory;
+        }
+        if (nullptr == memory)
+            memory = static_cast<char*>(previous_allocate(sizeof(allocation_header) + _size));
+        if (nullptr == memory)
+            return nullptr;
+        reinterpret_cast<allocation_header*>(memory)->from_arena = from_arena;
+        return memory + sizeof(allocation_header);
+    }
+
+    static void session_deallocate(void* _memory)
+    {
+        if (nullptr == _memory)
+            return;
+        char* memory = static_cast<char*>(_memory) - sizeof(allocation_header);
+        if (!reinterpret_cast<const allocation_header*>(memory)->from_arena)
+            previous_deallocate(memory);    // arena memory is freed when the arena is rewound
+    }
+
+    class session_state
+    {
+    public:
+        session_state(const size_t _arena_capacity, const bool _use_huge_pages)
+        : _arena(_arena_capacity, _use_huge_pages)
+        {
+            _writer_impl._session = this;
+            _writer_impl._output._arena = &_arena;
+            _reader_impl._session = this;
+        }
+
+        ~session_state()
+        {
+            _doc.reset();
+        }
+
+        void reset()
+        {
+            arena_scope scope(&_arena);
+            _doc.reset();
+            _arena.rewind();
+        }
+
+        // an empty document with only the document element, like a new document
+        pugi::xml_node start_document(const char* _name)
+        {
+            reset();
+            arena_scope scope(&_arena);
+            return _doc.append_child(_name);
+        }
+
+        // the writer's nodes are allocated from the arena by dom_output, other memory allocated while writing is not
+        writer_impl& begin_writing()
+        {
+            _writer_impl.reset_settings();
+            return _writer_impl;
+        }
+
+        reader_impl& begin_reading()
+        {
+            _reader_impl.reset_settings();
+            return _reader_impl;
+        }
+
+        arena _arena;   // declared before _doc, so the document's pages are returned before the arena is freed
+        pugi::xml_document _doc;
+        writer_impl _writer_impl;
+        reader_impl _reader_impl;
+    };
+}
+
+session::session(const size_t _arena_capacity, const bool _use_huge_pages)
+: _state(new impl::session_state(_arena_capacity, _use_huge_pages))
+{}
+
+session::~session()
+{
+    delete _state;
+}
+
+void session::install_memory_functions()
+{
+    static std::once_flag install_once;
+    std::call_once(install_once, []
+    {
+        impl::previous_allocate = pugi::get_memory_allocation_function();
+        impl::previous_deallocate = pugi::get_memory_deallocation_function();
+        pugi::set_memory_management_functions(impl::session_allocate, impl::session_deallocate);
+    });
+}
+
+pugi::xml_document& session::document()
+{
+    return _state->_doc;
+}
+
+void session::reset()
+{
+    _state->reset();
+}
+
+pugi::xml_parse_result session::load_buffer(const void* contents, const size_t size, const unsigned int parse_options)
+{
+    _state->reset();
+    impl::arena_scope scope(&_state->_arena);
+    return _state->_doc.load_buffer(contents, size, parse_options);
+}
+
+pugi::xml_parse_result session::load_string(const char* contents, const unsigned int parse_options)
+{
+    _state->reset();
+    impl::arena_scope scope(&_state->_arena);
+    return _state->_doc.load_string(contents, parse_options);
+}
+
+pugi::xml_parse_result session::load_file(const char* path, const unsigned int parse_options)
+{
+    _state->reset();
+    impl::arena_scope scope(&_state->_arena);
+    return _state->_doc.load_file(path, parse_options);
+}
+
+size_t session::arena_capacity() const
+{
+    return _state->_arena.capacity();
+}
+
+size_t session::arena_used() const
+{
+    return _state->_arena.used();
+}
 
 serializer_base::serializer_base(pugi::xml_node in_node, impl::impl_base& in_implementor)
 : _curr_node(in_node)
@@ -428,27 +3638,99 @@ serializer_base::serializer_base(pugi::xml_node in_node, impl::impl_base& in_imp
     
 serializer_base& serializer_base::operator=(const serializer_base& other)
 {
-    if (this != & other)
-    {
-        _curr_node = other._curr_node;
-        _implementor = other._implementor;
-    }
-    
-    return *this;
+    if (this != & other)
+    {
+        _curr_node = other._curr_node;
+        _last_child = other._last_child;
+        _implementor = other._implementor;
+    }
+    
+    return *this;
+}
+
+
+bool serializer_base::reading() const { return _implementor.reading();}
+bool serializer_base::writing() const { return _implementor.writing();}
+
+void serializer_base::set_should_write_default_values(const bool _should_write_default_values)
+{
+    _implementor.set_should_write_default_values(_should_write_default_values);
+}
+    
+bool serializer_base::get_should_write_default_values()
+{
+    return _implementor.get_should_write_default_values();
+}
+
+thread_pool* serializer_base::get_thread_pool() const
+{
+    return _implementor.get_thread_pool();
+}
+
+void serializer_base::set_observer(observer* _observer)
+{
+    _implementor.set_observer(_observer);
+}
+
+void serializer_base::set_tracer(trace_writer* _tracer)
+{
+    _implementor.set_tracer(_tracer);
+}
+
+trace_writer* serializer_base::get_tracer() const
+{
+    return _implementor.get_tracer();
+}
+
+std::pmr::memory_resource* serializer_base::get_memory_resource() const
+{
+    return _implementor.get_memory_resource();
+}
+
+id_index* serializer_base::get_id_index() const
+{
+    return _implementor.get_id_index();
 }
 
+std::shared_ptr<pugi::xml_document> serializer_base::document() const
+{
+    return _implementor.document();
+}
 
-bool serializer_base::reading() const { return _implementor.reading();}
-bool serializer_base::writing() const { return _implementor.writing();}
+bool serializer_base::has_document_nodes() const
+{
+    return _implementor.has_document_nodes();
+}
 
-void serializer_base::set_should_write_default_values(const bool _should_write_default_values)
+std::shared_ptr<const reader_settings> serializer_base::share_settings() const
 {
-    _implementor.set_should_write_default_values(_should_write_default_values);
+    return _implementor.share_settings();
 }
-    
-bool serializer_base::get_should_write_default_values()
+
+void serializer_base::write_copy(pugi::xml_node _src)
 {
-    return _implementor.get_should_write_default_values();
+    if (reading())
+        return;
+    for (pugi::xml_attribute attrib : _src.attributes())
+    {
+        std::string_view value = attrib.value();
+        attribute(attrib.name(), value);
+    }
+    for (pugi::xml_node src_child : _src.children())
+    {
+        if (pugi::node_element == src_child.type())
+            child(src_child.name()).write_copy(src_child);
+        else if (pugi::node_pcdata == src_child.type())
+        {
+            std::string_view value = src_child.value();
+            text(value);
+        }
+        else if (pugi::node_cdata == src_child.type())
+        {
+            std::string value = src_child.value();
+            cdata(value);
+        }
+    }
 }
 
 void serializer_base::serializer_base::node_name(std::string& _name)
@@ -456,37 +3738,99 @@ void serializer_base::serializer_base::node_name(std::string& _name)
     _implementor.node_name(_curr_node, _name);
 }
 
-serializer_base serializer_base::child(const char* _name)
+serializer_base serializer_base::child(const name_token& _name)
 {
-    pugi::xml_node a_node = _implementor.child(_curr_node, _name);
+    pugi::xml_node a_node = _implementor.child(_curr_node, _name, _last_child);
     return serializer_base(a_node, _implementor);
 }
 
-serializer_base serializer_base::next_sibling(const char* _name)
+serializer_base serializer_base::next_sibling(const name_token& _name)
 {
     pugi::xml_node a_node = _implementor.next_sibling(_curr_node, _name);
     return serializer_base(a_node, _implementor);
 }
 
+const char* serializer_base::node_name()
+{
+    return _implementor.node_name(_curr_node);
+}
+
+serializer_base serializer_base::first_child()
+{
+    pugi::xml_node a_node = _implementor.first_child(_curr_node);
+    return serializer_base(a_node, _implementor);
+}
+
+serializer_base serializer_base::next_sibling()
+{
+    pugi::xml_node a_node = _implementor.next_sibling(_curr_node);
+    return serializer_base(a_node, _implementor);
+}
+
 const char* serializer_base::c_str(const char* _c_str)
 {
     return _implementor.c_str(_curr_node, _c_str);
 }
 
+namespace impl
+{
+    // long and unsigned long have no virtual functions in impl_base, and are serialized as
+    // long long and unsigned long long. int64_t and uint64_t are long on some platforms.
+    template<typename TToSerialize> struct virtual_value { using type = TToSerialize; };
+    template<> struct virtual_value<long> { using type = long long; };
+    template<> struct virtual_value<unsigned long> { using type = unsigned long long; };
+    // std::pmr::string is serialized as std::string_view, and read values are copied into the string's memory resource
+    template<> struct virtual_value<std::pmr::string> { using type = std::string_view; };
+}
+
 template<typename TToSerialize>
 void serializer_base::text(TToSerialize& _val)
 {
-    _implementor.text(_curr_node, _val);
+    using virtual_type = typename impl::virtual_value<TToSerialize>::type;
+    if constexpr (std::is_same_v<virtual_type, TToSerialize>)
+        _implementor.text(_curr_node, _val);
+    else if constexpr (std::is_same_v<TToSerialize, std::pmr::string>)
+    {
+        std::string_view val = _val;
+        _implementor.text(_curr_node, val);
+        if (reading())
+            _val.assign(val);
+    }
+    else
+    {
+        virtual_type val = _val;
+        _implementor.text(_curr_node, val);
+        _val = static_cast<TToSerialize>(val);
+    }
 }
 
 template<typename TToSerialize, typename TDefault>
 void serializer_base::text(TToSerialize& _val, const TDefault def)
 {
-    _implementor.text(_curr_node, _val, def);
+    using virtual_type = typename impl::virtual_value<TToSerialize>::type;
+    if constexpr (std::is_same_v<virtual_type, TToSerialize>)
+        _implementor.text(_curr_node, _val, def);
+    else if constexpr (std::is_same_v<TToSerialize, std::pmr::string>)
+    {
+        std::string_view val = _val;
+        _implementor.text(_curr_node, val, std::string_view(def));
+        if (reading())
+            _val.assign(val);
+    }
+    else
+    {
+        virtual_type val = _val;
+        _implementor.text(_curr_node, val, static_cast<virtual_type>(def));
+        _val = static_cast<TToSerialize>(val);
+    }
 }
 
 template void serializer_base::text<std::string>(std::string&);
 template void serializer_base::text<std::string>(std::string&, const std::string_view);
+template void serializer_base::text<std::string_view>(std::string_view&);
+template void serializer_base::text<std::string_view>(std::string_view&, const std::string_view);
+template void serializer_base::text<std::pmr::string>(std::pmr::string&);
+template void serializer_base::text<std::pmr::string>(std::pmr::string&, const std::string_view);
 template void serializer_base::text<int>(int&);
 template void serializer_base::text<int>(int&, const int);
 template void serializer_base::text<unsigned>(unsigned&);
@@ -501,6 +3845,15 @@ template void serializer_base::text<long long>(long long&);
 template void serializer_base::text<long long>(long long&, const long long);
 template void serializer_base::text<unsigned long long>(unsigned long long&);
 template void serializer_base::text<unsigned long long>(unsigned long long&, const unsigned long long);
+template void serializer_base::text<long>(long&);
+template void serializer_base::text<long>(long&, const long);
+template void serializer_base::text<unsigned long>(unsigned long&);
+template void serializer_base::text<unsigned long>(unsigned long&, const unsigned long);
+
+void serializer_base::attributes(std::initializer_list<attribute_binding> _bindings)
+{
+    _implementor.attributes(_curr_node, _bindings.begin(), _bindings.size());
+}
 
 void serializer_base::cdata(std::string& _text)
 {
@@ -509,34 +3862,74 @@ void serializer_base::cdata(std::string& _text)
 
 
 template<typename TToSerialize>
-void serializer_base::attribute(const char* _name, TToSerialize& _val)
+void serializer_base::attribute(const name_token& _name, TToSerialize& _val)
 {
-    _implementor.attribute(_curr_node, _name, _val);
+    using virtual_type = typename impl::virtual_value<TToSerialize>::type;
+    if constexpr (std::is_same_v<virtual_type, TToSerialize>)
+        _implementor.attribute(_curr_node, _name, _val);
+    else if constexpr (std::is_same_v<TToSerialize, std::pmr::string>)
+    {
+        std::string_view val = _val;
+        _implementor.attribute(_curr_node, _name, val);
+        if (reading())
+            _val.assign(val);
+    }
+    else
+    {
+        virtual_type val = _val;
+        _implementor.attribute(_curr_node, _name, val);
+        _val = static_cast<TToSerialize>(val);
+    }
 }
 
 template<typename TToSerialize, typename TDefault>
-void serializer_base::attribute(const char* _name, TToSerialize& _val, const TDefault def)
-{
-    _implementor.attribute(_curr_node, _name, _val, def);
-}
-
-template void serializer_base::attribute<std::string>(const char* _name, std::string&);
-template void serializer_base::attribute<std::string>(const char* _name, std::string&, const char*);
-template void serializer_base::attribute<std::string>(const char* _name, std::string&, const std::string_view);
-template void serializer_base::attribute<int>(const char* _name, int&);
-template void serializer_base::attribute<int>(const char* _name, int&, const int);
-template void serializer_base::attribute<unsigned>(const char* _name, unsigned&);
-template void serializer_base::attribute<unsigned>(const char* _name, unsigned&, const unsigned);
-template void serializer_base::attribute<float>(const char* _name, float&);
-template void serializer_base::attribute<float>(const char* _name, float&, const float);
-template void serializer_base::attribute<double>(const char* _name, double&);
-template void serializer_base::attribute<double>(const char* _name, double&, const double);
-template void serializer_base::attribute<bool>(const char* _name, bool&);
-template void serializer_base::attribute<bool>(const char* _name, bool&, const bool);
-template void serializer_base::attribute<long long>(const char* _name, long long&);
-template void serializer_base::attribute<long long>(const char* _name, long long&, const long long);
-template void serializer_base::attribute<unsigned long long>(const char* _name, unsigned long long&);
-template void serializer_base::attribute<unsigned long long>(const char* _name, unsigned long long&, const unsigned long long);
+void serializer_base::attribute(const name_token& _name, TToSerialize& _val, const TDefault def)
+{
+    using virtual_type = typename impl::virtual_value<TToSerialize>::type;
+    if constexpr (std::is_same_v<virtual_type, TToSerialize>)
+        _implementor.attribute(_curr_node, _name, _val, def);
+    else if constexpr (std::is_same_v<TToSerialize, std::pmr::string>)
+    {
+        std::string_view val = _val;
+        _implementor.attribute(_curr_node, _name, val, std::string_view(def));
+        if (reading())
+            _val.assign(val);
+    }
+    else
+    {
+        virtual_type val = _val;
+        _implementor.attribute(_curr_node, _name, val, static_cast<virtual_type>(def));
+        _val = static_cast<TToSerialize>(val);
+    }
+}
+
+template void serializer_base::attribute<std::string>(const name_token& _name, std::string&);
+template void serializer_base::attribute<std::string>(const name_token& _name, std::string&, const char*);
+template void serializer_base::attribute<std::string>(const name_token& _name, std::string&, const std::string_view);
+template void serializer_base::attribute<std::string_view>(const name_token& _name, std::string_view&);
+template void serializer_base::attribute<std::string_view>(const name_token& _name, std::string_view&, const char*);
+template void serializer_base::attribute<std::string_view>(const name_token& _name, std::string_view&, const std::string_view);
+template void serializer_base::attribute<std::pmr::string>(const name_token& _name, std::pmr::string&);
+template void serializer_base::attribute<std::pmr::string>(const name_token& _name, std::pmr::string&, const char*);
+template void serializer_base::attribute<std::pmr::string>(const name_token& _name, std::pmr::string&, const std::string_view);
+template void serializer_base::attribute<int>(const name_token& _name, int&);
+template void serializer_base::attribute<int>(const name_token& _name, int&, const int);
+template void serializer_base::attribute<unsigned>(const name_token& _name, unsigned&);
+template void serializer_base::attribute<unsigned>(const name_token& _name, unsigned&, const unsigned);
+template void serializer_base::attribute<float>(const name_token& _name, float&);
+template void serializer_base::attribute<float>(const name_token& _name, float&, const float);
+template void serializer_base::attribute<double>(const name_token& _name, double&);
+template void serializer_base::attribute<double>(const name_token& _name, double&, const double);
+template void serializer_base::attribute<bool>(const name_token& _name, bool&);
+template void serializer_base::attribute<bool>(const name_token& _name, bool&, const bool);
+template void serializer_base::attribute<long long>(const name_token& _name, long long&);
+template void serializer_base::attribute<long long>(const name_token& _name, long long&, const long long);
+template void serializer_base::attribute<unsigned long long>(const name_token& _name, unsigned long long&);
+template void serializer_base::attribute<unsigned long long>(const name_token& _name, unsigned long long&, const unsigned long long);
+template void serializer_base::attribute<long>(const name_token& _name, long&);
+template void serializer_base::attribute<long>(const name_token& _name, long&, const long);
+template void serializer_base::attribute<unsigned long>(const name_token& _name, unsigned long&);
+template void serializer_base::attribute<unsigned long>(const name_token& _name, unsigned long&, const unsigned long);
 
 
 writer::writer(pugi::xml_document& doc, const char* doc_element_name)
@@ -549,22 +3942,412 @@ writer::writer(pugi::xml_node in_node)
 : serializer_base(in_node, *new impl::writer_impl)
 {}
 
+writer::writer(session& _session, const char* doc_element_name)
+: serializer_base(pugi::xml_node(), _session._state->begin_writing())
+{
+    _curr_node = _session._state->start_document(doc_element_name);
+}
+
 writer::~writer()
+{
+    if (nullptr == static_cast<impl::writer_impl&>(_implementor)._session)
+        delete & _implementor;
+}
+
+void writer::set_should_use_to_chars(const bool _should_use_to_chars)
+{
+    static_cast<impl::writer_impl&>(_implementor)._use_to_chars = _should_use_to_chars;
+}
+
+bool writer::get_should_use_to_chars() const
+{
+    return static_cast<const impl::writer_impl&>(_implementor)._use_to_chars;
+}
+
+void writer::set_thread_pool(thread_pool* _pool)
+{
+    static_cast<impl::writer_impl&>(_implementor)._thread_pool = _pool;
+}
+
+fragment_writer::fragment_writer(const serializer_base& _parent)
+: serializer_base(pugi::xml_node(), *_parent._implementor.new_fragment(_parent._curr_node))
+, _parent_implementor(_parent._implementor)
+, _parent_node(_parent._curr_node)
+{
+    _curr_node = _implementor.fragment_root();
+}
+
+fragment_writer::~fragment_writer()
+{
+    delete & _implementor;
+}
+
+void fragment_writer::append_to_parent()
+{
+    _parent_implementor.append_fragment(_parent_node, _implementor);
+}
+
+namespace
+{
+    template<typename... TArgs>
+    impl::update_writer_impl& start_update_writer(TArgs&&... _args)
+    {
+        auto* update_impl = new impl::update_writer_impl;
+        update_impl->_output.start(std::forward<TArgs>(_args)...);
+        return *update_impl;
+    }
+}
+
+update_writer::update_writer(pugi::xml_document& doc, const char* doc_element_name)
+: serializer_base(pugi::xml_node(), start_update_writer(doc, doc_element_name))
+{
+    _curr_node = static_cast<impl::update_writer_impl&>(_implementor)._output.root();
+}
+
+update_writer::update_writer(pugi::xml_node node)
+: serializer_base(node, start_update_writer(node))
+{}
+
+update_writer::~update_writer()
+{
+    finish();
+    delete & _implementor;
+}
+
+void update_writer::finish()
+{
+    static_cast<impl::update_writer_impl&>(_implementor)._output.finish();
+}
+
+const update_stats& update_writer::get_update_stats() const
+{
+    return static_cast<const impl::update_writer_impl&>(_implementor)._output.stats();
+}
+
+void update_writer::set_should_use_to_chars(const bool _should_use_to_chars)
+{
+    static_cast<impl::update_writer_impl&>(_implementor)._use_to_chars = _should_use_to_chars;
+}
+
+bool update_writer::get_should_use_to_chars() const
+{
+    return static_cast<const impl::update_writer_impl&>(_implementor)._use_to_chars;
+}
+
+namespace
+{
+    impl::stream_writer_impl& start_stream_writer(std::string* _out, std::function<void(const std::string&)> _flush, const char* doc_element_name, const char* _indent, const unsigned int _flags)
+    {
+        auto* stream_impl = new impl::stream_writer_impl;
+        stream_impl->_output.start(_out, std::move(_flush), doc_element_name, _indent, _flags);
+        return *stream_impl;
+    }
+}
+
+stream_writer::stream_writer(std::string& _out, const char* doc_element_name, const char* _indent, const unsigned int _flags)
+: serializer_base(pugi::xml_node(), start_stream_writer(&_out, nullptr, doc_element_name, _indent, _flags))
+{
+    _curr_node = static_cast<impl::stream_writer_impl&>(_implementor)._output.root();
+}
+
+stream_writer::stream_writer(std::ostream& _out, const char* doc_element_name, const char* _indent, const unsigned int _flags)
+: serializer_base(pugi::xml_node(), start_stream_writer(nullptr, [&_out](const std::string& _str) { _out.write(_str.data(), static_cast<std::streamsize>(_str.size())); }, doc_element_name, _indent, _flags))
+{
+    _curr_node = static_cast<impl::stream_writer_impl&>(_implementor)._output.root();
+}
+
+stream_writer::stream_writer(int _fd, const char* doc_element_name, const char* _indent, const unsigned int _flags)
+: serializer_base(pugi::xml_node(), start_stream_writer(nullptr, [_fd](const std::string& _str)
+    {
+        const char* data = _str.data();
+        size_t size = _str.size();
+        while (size > 0)
+        {
+#ifdef _WIN32
+            auto written = ::_write(_fd, data, static_cast<unsigned int>(size));
+#else
+            auto written = ::write(_fd, data, size);
+#endif
+            if (written <= 0)
+                break;
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }, doc_element_name, _indent, _flags))
+{
+    _curr_node = static_cast<impl::stream_writer_impl&>(_implementor)._output.root();
+}
+
+stream_writer::~stream_writer()
+{
+    finish();
+    delete & _implementor;
+}
+
+void stream_writer::finish()
+{
+    static_cast<impl::stream_writer_impl&>(_implementor)._output.finish();
+}
+
+void stream_writer::set_should_use_to_chars(const bool _should_use_to_chars)
+{
+    static_cast<impl::stream_writer_impl&>(_implementor)._use_to_chars = _should_use_to_chars;
+}
+
+bool stream_writer::get_should_use_to_chars() const
+{
+    return static_cast<const impl::stream_writer_impl&>(_implementor)._use_to_chars;
+}
+
+void stream_writer::set_thread_pool(thread_pool* _pool)
+{
+    static_cast<impl::stream_writer_impl&>(_implementor)._thread_pool = _pool;
+}
+
+size_t stream_writer::get_out_of_order_count() const
+{
+    return static_cast<const impl::stream_writer_impl&>(_implementor)._output.out_of_order_count();
+}
+
+binary_writer::binary_writer(std::string& _out, const char* doc_element_name)
+: serializer_base(pugi::xml_node(), *new impl::binary_writer_impl)
+{
+    auto& binary_impl = static_cast<impl::binary_writer_impl&>(_implementor);
+    binary_impl._output.start(&_out, doc_element_name);
+    _curr_node = binary_impl._output.root();
+}
+
+binary_writer::~binary_writer()
+{
+    finish();
+    delete & _implementor;
+}
+
+void binary_writer::finish()
+{
+    static_cast<impl::binary_writer_impl&>(_implementor)._output.finish();
+}
+
+binary_reader::binary_reader(const void* _data, const size_t _size)
+: serializer_base(pugi::xml_node(), *new impl::binary_reader_impl(static_cast<const unsigned char*>(_data), _size))
+{
+    _curr_node = static_cast<impl::binary_reader_impl&>(_implementor).root();
+}
+
+binary_reader::binary_reader(const std::string& _data)
+: binary_reader(_data.data(), _data.size())
+{}
+
+binary_reader::~binary_reader()
 {
     delete & _implementor;
 }
 
+pugi::xml_parse_status binary_reader::status() const
+{
+    return static_cast<const impl::binary_reader_impl&>(_implementor)._status;
+}
+
+namespace
+{
+    // a document parsed in place from a private mapping of a file, the document is destroyed before the file is unmapped
+    struct mapped_file_document
+    {
+        void* mapping = nullptr;
+        size_t mapping_size = 0;
+        pugi::xml_document doc;
+
+        ~mapped_file_document()
+        {
+            doc.reset();
+#ifndef _WIN32
+            if (nullptr != mapping)
+                ::munmap(mapping, mapping_size);
+#endif
+        }
+    };
+
+#ifndef _WIN32
+    // map the file copy-on-write, so parsing in place does not change the file
+    void* map_file(const char* path, const unsigned int map_hints, size_t& _size)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        void* mapping = nullptr;
+        struct stat file_stat;
+        if (0 == ::fstat(fd, &file_stat) && file_stat.st_size > 0)
+        {
+            _size = static_cast<size_t>(file_stat.st_size);
+            mapping = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (MAP_FAILED == mapping)
+                mapping = nullptr;
+        }
+        ::close(fd);
+
+        if (nullptr != mapping)
+        {
+            if (0 != (map_hints & map_hint_sequential))
+                ::madvise(mapping, _size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+            if (0 != (map_hints & map_hint_hugepages))
+                ::madvise(mapping, _size, MADV_HUGEPAGE);
+#endif
+        }
+        return mapping;
+    }
+#endif
+}
+
+std::shared_ptr<pugi::xml_document> load_mapped_file(const char* path, const unsigned int parse_options, const unsigned int map_hints, pugi::xml_parse_result* _result)
+{
+    auto holder = std::make_shared<mapped_file_document>();
+    pugi::xml_parse_result result;
+#ifndef _WIN32
+    holder->mapping = map_file(path, map_hints, holder->mapping_size);
+#endif
+    if (nullptr != holder->mapping)
+        result = holder->doc.load_buffer_inplace(holder->mapping, holder->mapping_size, parse_options);
+    else
+        result = holder->doc.load_file(path, parse_options);
+
+    if (nullptr != _result)
+        *_result = result;
+    // the returned pointer shares the ownership of holder, so the mapping lives as long as the document
+    return std::shared_ptr<pugi::xml_document>(holder, &holder->doc);
+}
+
+stream_reader::stream_reader(std::istream& in, const unsigned int parse_options)
+: _scanner(new impl::item_scanner(&in, nullptr, 0, parse_options)) {}
+
+stream_reader::stream_reader(const char* data, const size_t size, const unsigned int parse_options)
+: _scanner(new impl::item_scanner(nullptr, data, size, parse_options)) {}
+
+stream_reader::~stream_reader()
+{
+    delete _scanner;
+}
+
+pugi::xml_node stream_reader::root() const
+{
+    return _scanner->root();
+}
+
+pugi::xml_node stream_reader::next_item()
+{
+    return _scanner->next_item();
+}
+
+pugi::xml_parse_status stream_reader::status() const
+{
+    return _scanner->status();
+}
+
 reader::reader(pugi::xml_document& doc)
 : serializer_base(doc.document_element(), *new impl::reader_impl) {}
 
 reader::reader(pugi::xml_node in_node)
 : serializer_base(in_node, *new impl::reader_impl) {}
 
+reader::reader(std::shared_ptr<pugi::xml_document> doc)
+: serializer_base(doc->document_element(), *new impl::reader_impl)
+{
+    static_cast<impl::reader_impl&>(_implementor)._doc = std::move(doc);
+}
+
+reader::reader(session& _session)
+: serializer_base(_session._state->_doc.document_element(), _session._state->begin_reading())
+{}
+
 reader::~reader()
 {
+    if (nullptr == static_cast<impl::reader_impl&>(_implementor)._session)
+        delete & _implementor;
+}
+
+void reader::set_should_use_ordered_lookup(const bool _should_use_ordered_lookup)
+{
+    static_cast<impl::reader_impl&>(_implementor)._use_ordered_lookup = _should_use_ordered_lookup;
+}
+
+bool reader::get_should_use_ordered_lookup() const
+{
+    return static_cast<const impl::reader_impl&>(_implementor)._use_ordered_lookup;
+}
+
+lookup_stats reader::get_lookup_stats() const
+{
+    return static_cast<const impl::reader_impl&>(_implementor)._lookup_stats;
+}
+
+void reader::set_should_use_plans(const bool _should_use_plans)
+{
+    static_cast<impl::reader_impl&>(_implementor)._use_plans = _should_use_plans;
+}
+
+bool reader::get_should_use_plans() const
+{
+    return static_cast<const impl::reader_impl&>(_implementor)._use_plans;
+}
+
+plan_stats reader::get_plan_stats() const
+{
+    return static_cast<const impl::reader_impl&>(_implementor)._plans._stats;
+}
+
+void reader::set_should_use_from_chars(const bool _should_use_from_chars)
+{
+    static_cast<impl::reader_impl&>(_implementor)._use_from_chars = _should_use_from_chars;
+}
+
+bool reader::get_should_use_from_chars() const
+{
+    return static_cast<const impl::reader_impl&>(_implementor)._use_from_chars;
+}
+
+const std::vector<number_parse_error>& reader::get_parse_errors() const
+{
+    return static_cast<const impl::reader_impl&>(_implementor)._parse_errors;
+}
+
+void reader::set_memory_resource(std::pmr::memory_resource* _resource)
+{
+    _implementor.set_memory_resource(_resource);
+}
+
+void reader::set_id_index(id_index* _index)
+{
+    _implementor.set_id_index(_index);
+}
+
+void reader::set_thread_pool(thread_pool* _pool)
+{
+    static_cast<impl::reader_impl&>(_implementor)._thread_pool = _pool;
+}
+
+task_reader::task_reader(const serializer_base& _parent)
+: serializer_base(_parent._curr_node, *_parent._implementor.clone_settings())
+, _parent_implementor(&_parent._implementor)
+{}
+
+task_reader::task_reader(const reader_settings& _settings, pugi::xml_node _node)
+: serializer_base(_node, *_settings._settings->clone_settings())
+, _parent_implementor(nullptr)
+{}
+
+task_reader::~task_reader()
+{
+    if (nullptr != _parent_implementor)
+        _parent_implementor->merge_results(_implementor);
     delete & _implementor;
 }
 
+reader_settings::~reader_settings()
+{
+    delete _settings;
+}
+
 }  // namespace pugi_serializer
 
 #endif // __SOURCE_PUGI_SERIALIZER_CPP__
@@ -23,6 +23,28 @@
 #endif
 
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <compare>
+#include <initializer_list>
+#include <iosfwd>
+#include <functional>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <system_error>
+#include <vector>
 
 // Include pugixml header
 #include "pugixml.hpp"
@@ -47,7 +69,733 @@
 namespace pugi_serializer
 {
 
-    namespace impl { class impl_base; }
+    namespace impl { class impl_base; class item_scanner; class pool_state; class reader_impl; class session_state; }
+    class session;
+    class reader_settings;
+
+    // a pool of threads, each with its own queue of tasks. A thread whose queue is empty takes tasks from the other queues.
+    class XML_SERIALIZER_CLASS thread_pool
+    {
+    public:
+        // num_threads == 0: one thread per hardware thread
+        explicit thread_pool(const unsigned int num_threads = 0);
+        ~thread_pool();
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        unsigned int size() const;
+
+        // call _func(i) for each i in [0, _count) on the pool's threads, and return when all calls returned.
+        // The calling thread runs tasks while waiting, so parallel_for can be called from inside another parallel_for.
+        // If calls throw, the remaining calls are skipped, and the first exception is rethrown once all tasks finished.
+        void parallel_for(const size_t _count, const std::function<void(size_t)>& _func);
+
+    private:
+        impl::pool_state* _state;
+    };
+
+    // name of an element or attribute, with precomputed length and hash
+    // implicitly constructed from const char*, so any function accepting name_token can be called with a string,
+    // when constructed from a string literal in a constant expression (e.g. with the _name literal below) length and hash
+    // are computed at compile time.
+    // The string is not copied, it should outlive the name_token.
+    class name_token
+    {
+    public:
+        constexpr name_token(const char* _str)
+        : _str(_str)
+        , _len(calc_length(_str))
+        , _hash(calc_hash(_str, _len))
+        {}
+
+        constexpr name_token(const char* _str, const size_t _len)
+        : _str(_str)
+        , _len(_len)
+        , _hash(calc_hash(_str, _len))
+        {}
+
+        constexpr const char* c_str() const { return _str; }
+        constexpr size_t length() const { return _len; }
+        constexpr uint32_t hash() const { return _hash; }
+        constexpr std::string_view view() const { return std::string_view(_str, _len); }
+
+        // compare to a null terminated name, checking the first character before doing a full compare
+        bool matches(const char* _other) const
+        {
+            return _other[0] == _str[0]
+                && 0 == std::strncmp(_other, _str, _len)
+                && '\0' == _other[_len];
+        }
+
+        friend constexpr bool operator==(const name_token& lhs, const name_token& rhs)
+        {
+            return lhs._hash == rhs._hash && lhs.view() == rhs.view();
+        }
+
+        // 32 bit FNV-1a
+        static constexpr uint32_t calc_hash(const char* _str, const size_t _len)
+        {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < _len; ++i)
+            {
+                hash ^= static_cast<unsigned char>(_str[i]);
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+    private:
+        static constexpr size_t calc_length(const char* _str)
+        {
+            size_t len = 0;
+            while ('\0' != _str[len])
+                ++len;
+            return len;
+        }
+
+        const char* _str;
+        size_t _len;
+        uint32_t _hash;
+    };
+
+    namespace literals
+    {
+        // "country"_name is a name_token built at compile time
+        consteval name_token operator""_name(const char* _str, size_t _len)
+        {
+            return name_token(_str, _len);
+        }
+    }
+
+    // binds an attribute name to a value, and optionally to a default value
+    // used to read or write many attributes of the same element at once, see serializer_base::attributes
+    // the default of a string value is not copied, so it should be a const char* or std::string_view
+    class attribute_binding
+    {
+    public:
+        enum class value_type : uint8_t
+        {
+            string_value, string_view_value, int_value, uint_value, float_value, double_value, bool_value, llong_value, ullong_value
+        };
+
+        template<typename TValue>
+        attribute_binding(const name_token& _name, TValue& _val)
+        : name(_name)
+        , type(type_of<TValue>())
+        , value(&_val)
+        , has_default(false)
+        {}
+
+        template<typename TValue, typename TDefault>
+        attribute_binding(const name_token& _name, TValue& _val, const TDefault def)
+        : name(_name)
+        , type(type_of<TValue>())
+        , value(&_val)
+        , has_default(true)
+        {
+            if constexpr (std::is_same_v<TValue, std::string> || std::is_same_v<TValue, std::string_view>)
+            {
+                static_assert(std::is_same_v<TDefault, const char*> || std::is_same_v<TDefault, char*> || std::is_same_v<TDefault, std::string_view>,
+                              "attribute_binding: the default of a string should be a const char* or std::string_view, a std::string default would dangle");
+                default_text = std::string_view(def);
+            }
+            else
+                default_value_ref<TValue>() = static_cast<TValue>(def);
+        }
+
+        // call _func(value&, default) with the actual types of the value and default
+        template<typename TFunc>
+        void visit(TFunc&& _func) const
+        {
+            switch (type)
+            {
+                case value_type::string_value: _func(*static_cast<std::string*>(value), default_text); break;
+                case value_type::string_view_value: _func(*static_cast<std::string_view*>(value), default_text); break;
+                case value_type::int_value: _func(*static_cast<int*>(value), default_value.int_value); break;
+                case value_type::uint_value: _func(*static_cast<unsigned*>(value), default_value.uint_value); break;
+                case value_type::float_value: _func(*static_cast<float*>(value), default_value.float_value); break;
+                case value_type::double_value: _func(*static_cast<double*>(value), default_value.double_value); break;
+                case value_type::bool_value: _func(*static_cast<bool*>(value), default_value.bool_value); break;
+                case value_type::llong_value: _func(*static_cast<long long*>(value), default_value.llong_value); break;
+                case value_type::ullong_value: _func(*static_cast<unsigned long long*>(value), default_value.ullong_value); break;
+            }
+        }
+
+        name_token name;
+        value_type type;
+        void* value;
+        bool has_default;
+        union
+        {
+            int int_value;
+            unsigned uint_value;
+            float float_value;
+            double double_value;
+            bool bool_value;
+            long long llong_value;
+            unsigned long long ullong_value = 0;
+        } default_value;
+        std::string_view default_text;
+
+    private:
+        template<typename TValue>
+        static constexpr value_type type_of()
+        {
+            if constexpr (std::is_same_v<TValue, std::string>) return value_type::string_value;
+            else if constexpr (std::is_same_v<TValue, std::string_view>) return value_type::string_view_value;
+            else if constexpr (std::is_same_v<TValue, int>) return value_type::int_value;
+            else if constexpr (std::is_same_v<TValue, unsigned>) return value_type::uint_value;
+            else if constexpr (std::is_same_v<TValue, float>) return value_type::float_value;
+            else if constexpr (std::is_same_v<TValue, double>) return value_type::double_value;
+            else if constexpr (std::is_same_v<TValue, bool>) return value_type::bool_value;
+            else if constexpr (std::is_same_v<TValue, long long>) return value_type::llong_value;
+            else if constexpr (std::is_same_v<TValue, unsigned long long>) return value_type::ullong_value;
+            else static_assert(sizeof(TValue) == 0, "attribute_binding: unsupported value type");
+        }
+
+        template<typename TValue>
+        TValue& default_value_ref()
+        {
+            if constexpr (std::is_same_v<TValue, int>) return default_value.int_value;
+            else if constexpr (std::is_same_v<TValue, unsigned>) return default_value.uint_value;
+            else if constexpr (std::is_same_v<TValue, float>) return default_value.float_value;
+            else if constexpr (std::is_same_v<TValue, double>) return default_value.double_value;
+            else if constexpr (std::is_same_v<TValue, bool>) return default_value.bool_value;
+            else if constexpr (std::is_same_v<TValue, long long>) return default_value.llong_value;
+            else return default_value.ullong_value;
+        }
+    };
+
+    // counters of child lookups done by a reader
+    struct lookup_stats
+    {
+        size_t cursor_hits = 0;     // child found right after the previously found child
+        size_t cursor_misses = 0;   // child had to be searched from the first child
+    };
+
+    // counters of a reader's serialization plans, see reader::set_should_use_plans
+    struct plan_stats
+    {
+        size_t plans_recorded = 0;  // element names whose calls were recorded
+        size_t hits = 0;            // attribute or child found at its planned position
+        size_t misses = 0;          // call differed from the plan, or the planned position had another name
+    };
+
+    // changes made to a document by an update_writer
+    struct update_stats
+    {
+        size_t values_changed = 0;      // text, cdata, attribute values and element names set to a different value
+        size_t nodes_added = 0;         // elements, and cdata, that did not exist
+        size_t nodes_removed = 0;       // elements, text and cdata that were not written again
+        size_t attributes_added = 0;
+        size_t attributes_removed = 0;
+
+        // 0 if the document is unchanged
+        size_t touched() const { return values_changed + nodes_added + nodes_removed + attributes_added + attributes_removed; }
+    };
+
+    // a number that could not be read by a reader using std::from_chars, see reader::set_should_use_from_chars
+    struct number_parse_error
+    {
+        const char* name;   // name of the element or attribute, points into the document
+        const char* text;   // the text that could not be parsed, points into the document
+        std::errc error;    // std::errc::invalid_argument or std::errc::result_out_of_range
+    };
+
+    // one call of a serialize function, passed to an observer
+    struct observed_call
+    {
+        const char* name = "";      // the element or attribute name, for text the name of the element
+        size_t scanned = 0;         // reading: number of elements or attributes whose name was compared to find name
+        bool found = true;          // reading: false if there was no such element, attribute or text
+        bool default_used = false;  // reading: the default was assigned, writing: a value equal to the default was not written
+        size_t bytes_copied = 0;    // length of a std::string value copied from the document or to the output
+    };
+
+    // notified of the calls made by serialize functions, see serializer_base::set_observer.
+    // when a thread_pool is used, the functions are called from the pool's threads.
+    class XML_SERIALIZER_CLASS observer
+    {
+    public:
+        virtual ~observer() = default;
+
+        virtual void on_child(const observed_call&) {}         // child() or next_sibling() with a name
+        virtual void on_attribute(const observed_call&) {}     // attribute() or an attribute of attributes()
+        virtual void on_text(const observed_call&) {}          // text()
+    };
+
+    // an observer that adds up the calls for each element name and for each attribute name, thread safe
+    class XML_SERIALIZER_CLASS counting_observer : public observer
+    {
+    public:
+        struct counters
+        {
+            size_t calls = 0;
+            size_t scanned = 0;
+            size_t misses = 0;          // not found
+            size_t defaults = 0;        // default used
+            size_t bytes_copied = 0;
+        };
+
+        void on_child(const observed_call& _call) override;
+        void on_attribute(const observed_call& _call) override;
+        void on_text(const observed_call& _call) override;
+
+        // counters of child() lookups and text() calls, by element name
+        std::map<std::string, counters, std::less<>> elements() const;
+        // counters of attribute() calls, by attribute name
+        std::map<std::string, counters, std::less<>> attributes() const;
+        // the sum of all counters
+        counters total() const;
+        void reset();
+
+    private:
+        static void add(std::map<std::string, counters, std::less<>>& _counters, const observed_call& _call);
+
+        mutable std::mutex _mutex;
+        std::map<std::string, counters, std::less<>> _elements;
+        std::map<std::string, counters, std::less<>> _attributes;
+    };
+
+    // writes spans as chrome trace event json, to be opened with chrome://tracing or https://ui.perfetto.dev.
+    // serialize_container, serialize_containers and serialize_container_parallel add a span for each call,
+    // with the item name and count, and a span for each item that took at least _min_item_us microseconds,
+    // when their serializer has a trace_writer, see serializer_base::set_tracer.
+    // Other phases, e.g. loading or saving the document, can be traced with trace_span.
+    // Thread safe, spans from different threads are shown on different tracks.
+    class XML_SERIALIZER_CLASS trace_writer
+    {
+    public:
+        explicit trace_writer(std::ostream& _out, const double _min_item_us = 100.0);
+        ~trace_writer();
+        trace_writer(const trace_writer&) = delete;
+        trace_writer& operator=(const trace_writer&) = delete;
+
+        // write the end of the json, called by the destructor. spans that end later are not written.
+        void finish();
+
+        // microseconds since the trace_writer was created
+        int64_t now_us() const;
+
+        // write a span that started at _start_us and ends now.
+        // _args is a json object's members, e.g. "\"count\":5", or empty.
+        void complete(const char* _name, const char* _category, const int64_t _start_us, std::string_view _args = {});
+
+        // used by serialize_container: span of a container, and span of an item if it took at least _min_item_us
+        void end_container(const char* _item_name, const int64_t _start_us, const size_t _num_items);
+        void end_item(const char* _item_name, const int64_t _start_us, const size_t _index);
+
+    private:
+        std::ostream& _out;
+        std::mutex _mutex;
+        const double _min_item_us;
+        const int64_t _origin_ns;
+        bool _first_event = true;
+        bool _finished = false;
+    };
+
+    // a span from construction to destruction, e.g. around pugi::xml_document::load_file or save_file.
+    // does nothing if _tracer is nullptr.
+    class XML_SERIALIZER_CLASS trace_span
+    {
+    public:
+        trace_span(trace_writer* _tracer, const char* _name, const char* _category = "pugi_serializer");
+        ~trace_span();
+        trace_span(const trace_span&) = delete;
+        trace_span& operator=(const trace_span&) = delete;
+
+    private:
+        trace_writer* _tracer;
+        const char* _name;
+        const char* _category;
+        int64_t _start_us = 0;
+    };
+
+    class id_index;
+
+    // a reference to a T by its id, e.g. a country's capital city.
+    // The id is read and written as an attribute by serialize_ref, and the T is found by id_index::resolve()
+    // when reading is done, see reader::set_id_index.
+    // Refs are compared by id.
+    template<typename T>
+    class ref
+    {
+    public:
+        ref() = default;
+        explicit ref(std::string _id) : _id(std::move(_id)) {}
+        // a ref already bound to _target, whose id is _id
+        ref(T& _target, std::string _id) : _id(std::move(_id)), _target(std::addressof(_target)) {}
+
+        const std::string& id() const { return _id; }
+        // the T with id(), or nullptr if not resolved
+        T* get() const { return static_cast<T*>(_target); }
+        T& operator*() const { return *get(); }
+        T* operator->() const { return get(); }
+        explicit operator bool() const { return nullptr != _target; }
+
+        bool operator==(const ref& other) const { return _id == other._id; }
+        std::strong_ordering operator<=>(const ref& other) const { return _id.compare(other._id) <=> 0; }
+
+    private:
+        friend class id_index;
+        template<typename TSERIALIZER, typename TTarget>
+        friend void serialize_ref(TSERIALIZER& ser, const name_token& _attrib_name, ref<TTarget>& _ref);
+        template<typename TSERIALIZER, typename TTarget>
+        friend void serialize_ref(TSERIALIZER& ser, const name_token& _attrib_name, ref<TTarget>& _ref, const std::string_view default_id);
+
+        std::string _id;
+        void* _target = nullptr;
+    };
+
+    // objects by id, and refs to be bound to them, filled while reading, see reader::set_id_index.
+    // Objects are added by serialize_id, refs by serialize_ref. resolve() binds each ref with one hash lookup,
+    // to the object with the ref's id, if that object was added as the ref's type T.
+    // Objects and refs are kept by address, so they should not move until resolve(). The container functions reserve
+    // a container for the items of one parent, so a vector read from a single parent keeps its items in place, but
+    // a vector that several parents append to is reallocated, which moves the items already added: such a container
+    // should be reserved for all its items before reading, or be a std::deque. In debug builds, the container
+    // functions assert that no added item was moved.
+    // serialize_array, serialize_keyed_container and serialize_each read each item into a temporary, so their items
+    // should not be added.
+    // Thread safe, objects and refs can be added by serialize_container_parallel's threads.
+    class XML_SERIALIZER_CLASS id_index
+    {
+    public:
+        // add _object with id _id. false if another object was already added with _id, that object is kept
+        template<typename T>
+        bool add(const std::string& _id, T& _object) { return add(_id, std::addressof(_object), typeid(T)); }
+
+        // the object added with _id, or nullptr if there is none or it is not a T
+        template<typename T>
+        T* find(const std::string_view _id) const { return static_cast<T*>(find(_id, typeid(T))); }
+
+        // _ref is bound by the next resolve()
+        template<typename T>
+        void add_ref(ref<T>& _ref) { add_ref(_ref._id, _ref._target, typeid(T)); }
+
+        // bind the refs added since the last resolve(), return the number of refs whose object was not found
+        size_t resolve();
+
+        size_t size() const;            // number of objects
+        size_t duplicates() const;      // objects that were not added because their id was already added
+        void clear();
+
+    private:
+        bool add(const std::string& _id, void* _object, const std::type_info& _type);
+        void* find(const std::string_view _id, const std::type_info& _type) const;
+        void add_ref(const std::string& _id, void*& _target, const std::type_info& _type);
+
+        struct string_hash
+        {
+            using is_transparent = void;
+            size_t operator()(const std::string_view _str) const { return std::hash<std::string_view>()(_str); }
+        };
+        struct indexed_object
+        {
+            void* object;
+            const std::type_info* type;
+        };
+        struct pending_ref
+        {
+            const std::string* id;
+            void** target;
+            const std::type_info* type;
+        };
+
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string, indexed_object, string_hash, std::equal_to<>> _objects;
+        std::vector<pending_ref> _refs;
+        size_t _duplicates = 0;
+    };
+
+    namespace impl
+    {
+        // node and value access shared by the runtime reader/writer (impl::reader_impl, impl::writer_impl)
+        // and the compile-time basic_serializer
+
+        // lookups compare names with name_token::matches, which rejects most
+        // non-matching names without a full string compare
+        inline pugi::xml_node find_child(pugi::xml_node _node, const name_token& _name)
+        {
+            auto a_child_node = _node.first_child();
+            while (a_child_node && !_name.matches(a_child_node.name()))
+                a_child_node = a_child_node.next_sibling();
+            return a_child_node;
+        }
+
+        // try the sibling following _last_child (or the first child if there is no _last_child)
+        // before searching all children
+        inline pugi::xml_node find_child_ordered(pugi::xml_node _node, const name_token& _name, pugi::xml_node& _last_child, lookup_stats& _stats)
+        {
+            auto candidate = _last_child ? _last_child.next_sibling() : _node.first_child();
+            if (candidate && _name.matches(candidate.name()))
+            {
+                ++_stats.cursor_hits;
+                _last_child = candidate;
+                return candidate;
+            }
+
+            ++_stats.cursor_misses;
+            auto a_child_node = find_child(_node, _name);
+            if (a_child_node)
+                _last_child = a_child_node;
+            return a_child_node;
+        }
+
+        inline pugi::xml_node find_next_sibling(pugi::xml_node older_sibling, const name_token& _name)
+        {
+            auto younger_sibling = older_sibling.next_sibling();
+            while (younger_sibling && !_name.matches(younger_sibling.name()))
+                younger_sibling = younger_sibling.next_sibling();
+            return younger_sibling;
+        }
+
+        // skip anything that is not an element, e.g. comments or pcdata
+        inline pugi::xml_node first_element_child(pugi::xml_node _node)
+        {
+            auto a_child_node = _node.first_child();
+            while (a_child_node && pugi::node_element != a_child_node.type())
+                a_child_node = a_child_node.next_sibling();
+            return a_child_node;
+        }
+
+        inline pugi::xml_node next_element_sibling(pugi::xml_node older_sibling)
+        {
+            auto younger_sibling = older_sibling.next_sibling();
+            while (younger_sibling && pugi::node_element != younger_sibling.type())
+                younger_sibling = younger_sibling.next_sibling();
+            return younger_sibling;
+        }
+
+        inline pugi::xml_attribute find_attribute(pugi::xml_node _node, const name_token& _attrib_name)
+        {
+            auto attrib = _node.first_attribute();
+            while (attrib && !_attrib_name.matches(attrib.name()))
+                attrib = attrib.next_attribute();
+            return attrib;
+        }
+
+        // read the value of an existing attribute or of a node's text,
+        // TSource is pugi::xml_attribute or pugi::xml_text
+        template<typename TSource> void read_value(const TSource& _src, std::string& _val) { _val = _src.as_string(); }
+        // the view points into the document, see reader(std::shared_ptr<pugi::xml_document>)
+        template<typename TSource> void read_value(const TSource& _src, std::string_view& _val) { _val = _src.as_string(); }
+        // copied into the string's own memory resource
+        template<typename TSource> void read_value(const TSource& _src, std::pmr::string& _val) { _val = _src.as_string(); }
+        template<typename TSource> void read_value(const TSource& _src, int& _val) { _val = _src.as_int(); }
+        template<typename TSource> void read_value(const TSource& _src, unsigned& _val) { _val = _src.as_uint(); }
+        template<typename TSource> void read_value(const TSource& _src, float& _val) { _val = _src.as_float(); }
+        template<typename TSource> void read_value(const TSource& _src, double& _val) { _val = _src.as_double(); }
+        template<typename TSource> void read_value(const TSource& _src, bool& _val) { _val = _src.as_bool(); }
+        template<typename TSource> void read_value(const TSource& _src, long long& _val) { _val = _src.as_llong(); }
+        template<typename TSource> void read_value(const TSource& _src, unsigned long long& _val) { _val = _src.as_ullong(); }
+        template<typename TSource> void read_value(const TSource& _src, long& _val) { _val = static_cast<long>(_src.as_llong()); }
+        template<typename TSource> void read_value(const TSource& _src, unsigned long& _val) { _val = static_cast<unsigned long>(_src.as_ullong()); }
+
+        // parse a number with std::from_chars: locale independent, and does not skip anything but surrounding white space.
+        // empty text is read as 0, other text that is not a number is read as 0 and appended to _errors.
+        template<typename TNumber>
+        void parse_number(const char* _name, const char* _text, TNumber& _val, std::vector<number_parse_error>& _errors)
+        {
+            auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+            const char* first = _text;
+            const char* last = _text + std::strlen(_text);
+            while (first != last && is_space(*first))
+                ++first;
+            while (first != last && is_space(*(last - 1)))
+                --last;
+            if (first == last)
+            {
+                _val = 0;
+                return;
+            }
+
+            if (*first == '+')  // accepted by strtol/strtod but not by std::from_chars
+                ++first;
+
+            std::from_chars_result result;
+            if constexpr (std::is_integral_v<TNumber>)
+            {
+                if (last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X'))  // hex, same as pugixml
+                    result = std::from_chars(first + 2, last, _val, 16);
+                else
+                    result = std::from_chars(first, last, _val);
+            }
+            else
+                result = std::from_chars(first, last, _val);
+
+            if (result.ec == std::errc() && result.ptr != last)
+                result.ec = std::errc::invalid_argument;  // trailing characters
+            if (result.ec != std::errc())
+            {
+                _val = 0;
+                _errors.push_back({_name, _text, result.ec});
+            }
+        }
+
+        // same as read_value, but if _errors is not null numbers are read with parse_number
+        template<typename TSource, typename TToRead>
+        void read_value(const TSource& _src, TToRead& _val, const char* _name, std::vector<number_parse_error>* _errors)
+        {
+            if constexpr (std::is_arithmetic_v<TToRead> && !std::is_same_v<TToRead, bool>)
+            {
+                if (nullptr != _errors)
+                {
+                    parse_number(_name, _src.as_string(), _val, *_errors);
+                    return;
+                }
+            }
+            read_value(_src, _val);
+        }
+
+        // _errors: when not null, numbers are read with std::from_chars and failures are appended to _errors
+        template<typename TToRead>
+        void read_text(pugi::xml_node _node, TToRead& _val, std::vector<number_parse_error>* _errors = nullptr)
+        // missing text is read as empty string or 0
+        {
+            read_value(_node.text(), _val, _node.name(), _errors);
+        }
+
+        template<typename TToRead, typename TDefault>
+        void read_text_with_default(pugi::xml_node _node, TToRead& _val, const TDefault def, std::vector<number_parse_error>* _errors = nullptr)
+        // return default if the node has no text
+        {
+            if (auto node_text = _node.text(); node_text)
+                read_value(node_text, _val, _node.name(), _errors);
+            else
+                _val = def;
+        }
+
+        template<typename TToRead>
+        void read_attribute(pugi::xml_node _node, const name_token& _attrib_name, TToRead& _val, std::vector<number_parse_error>* _errors = nullptr)
+        // leave _val unchanged if attribute does not exists
+        {
+            if (auto attrib = find_attribute(_node, _attrib_name); attrib)
+                read_value(attrib, _val, attrib.name(), _errors);
+        }
+
+        template<typename TToRead, typename TDefault>
+        void read_attribute_with_default(pugi::xml_node _node, const name_token& _attrib_name, TToRead& _val, const TDefault def, std::vector<number_parse_error>* _errors = nullptr)
+        // return default if attribute does not exists
+        {
+            if (auto attrib = find_attribute(_node, _attrib_name); attrib)
+                read_value(attrib, _val, attrib.name(), _errors);
+            else
+                _val = def;
+        }
+
+        // read all bindings in one walk over the node's attributes.
+        // bindings are searched starting after the last one found, so if the bindings
+        // are in the same order as the attributes, each attribute is matched on the first compare.
+        inline void read_attributes(pugi::xml_node _node, const attribute_binding* _bindings, const size_t _num_bindings, std::vector<number_parse_error>* _errors = nullptr)
+        {
+            constexpr size_t max_bindings_per_walk = 64;  // bits in not_found_mask
+            for (size_t first_binding = 0; first_binding < _num_bindings; first_binding += max_bindings_per_walk)
+            {
+                const attribute_binding* bindings = _bindings + first_binding;
+                const size_t num_bindings = std::min(_num_bindings - first_binding, max_bindings_per_walk);
+                uint64_t not_found_mask = num_bindings == 64 ? ~uint64_t(0) : (uint64_t(1) << num_bindings) - 1;
+
+                size_t expected_binding = 0;
+                for (auto attrib = _node.first_attribute(); attrib && 0 != not_found_mask; attrib = attrib.next_attribute())
+                {
+                    const char* attrib_name = attrib.name();
+                    for (size_t i = 0; i < num_bindings; ++i)
+                    {
+                        size_t binding_index = expected_binding + i;
+                        if (binding_index >= num_bindings)
+                            binding_index -= num_bindings;
+
+                        if (0 != (not_found_mask & (uint64_t(1) << binding_index)) && bindings[binding_index].name.matches(attrib_name))
+                        {
+                            bindings[binding_index].visit([&](auto& _val, auto) { read_value(attrib, _val, attrib_name, _errors); });
+                            not_found_mask &= ~(uint64_t(1) << binding_index);
+                            expected_binding = binding_index + 1;
+                            break;
+                        }
+                    }
+                }
+
+                // attributes not found get their default, or remain unchanged if there is no default
+                for (size_t binding_index = 0; 0 != not_found_mask; ++binding_index, not_found_mask >>= 1)
+                {
+                    if (0 != (not_found_mask & 1) && bindings[binding_index].has_default)
+                        bindings[binding_index].visit([](auto& _val, auto def) { _val = def; });
+                }
+            }
+        }
+
+        inline pugi::xml_node append_child(pugi::xml_node _node, const name_token& _name)
+        {
+            auto new_node = _node.append_child();
+            new_node.set_name(_name.c_str());
+            return new_node;
+        }
+
+        inline void write_text(pugi::xml_node _node, const std::string& _val) { _node.text().set(_val.c_str()); }
+        inline void write_text(pugi::xml_node _node, const std::string_view _val) { _node.text().set(_val.data(), _val.size()); }
+        inline void write_text(pugi::xml_node _node, const std::pmr::string& _val) { _node.text().set(_val.c_str()); }
+        template<typename TToWrite>
+        void write_text(pugi::xml_node _node, const TToWrite& _val) { _node.text().set(_val); }
+
+        inline void write_attribute(pugi::xml_node _node, const name_token& _attrib_name, const std::string& _val)
+        {
+            _node.append_attribute(_attrib_name.c_str()).set_value(_val.c_str());
+        }
+        inline void write_attribute(pugi::xml_node _node, const name_token& _attrib_name, const std::string_view _val)
+        {
+            _node.append_attribute(_attrib_name.c_str()).set_value(_val.data(), _val.size());
+        }
+        inline void write_attribute(pugi::xml_node _node, const name_token& _attrib_name, const std::pmr::string& _val)
+        {
+            _node.append_attribute(_attrib_name.c_str()).set_value(_val.c_str());
+        }
+        template<typename TToWrite>
+        void write_attribute(pugi::xml_node _node, const name_token& _attrib_name, const TToWrite& _val)
+        {
+            _node.append_attribute(_attrib_name.c_str()).set_value(_val);
+        }
+
+        // large enough for the shortest round trip representation of a double, or any 64 bit integer
+        constexpr size_t to_chars_buffer_size = 32;
+
+        // write _val to _buffer with std::to_chars, return the number of chars written.
+        // float and double are written in the shortest form that reads back to the same value
+        template<typename TNumber>
+        size_t format_number(const TNumber _val, char* _buffer)
+        {
+            return static_cast<size_t>(std::to_chars(_buffer, _buffer + to_chars_buffer_size, _val).ptr - _buffer);
+        }
+
+        // same as write_text/write_attribute, but if _to_chars_buffer is not null numbers are formatted with format_number
+        template<typename TToWrite>
+        void write_text(pugi::xml_node _node, const TToWrite& _val, char* _to_chars_buffer)
+        {
+            if constexpr (std::is_arithmetic_v<TToWrite> && !std::is_same_v<TToWrite, bool>)
+            {
+                if (nullptr != _to_chars_buffer)
+                {
+                    _node.text().set(_to_chars_buffer, format_number(_val, _to_chars_buffer));
+                    return;
+                }
+            }
+            write_text(_node, _val);
+        }
+
+        template<typename TToWrite>
+        void write_attribute(pugi::xml_node _node, const name_token& _attrib_name, const TToWrite& _val, char* _to_chars_buffer)
+        {
+            if constexpr (std::is_arithmetic_v<TToWrite> && !std::is_same_v<TToWrite, bool>)
+            {
+                if (nullptr != _to_chars_buffer)
+                {
+                    _node.append_attribute(_attrib_name.c_str()).set_value(_to_chars_buffer, format_number(_val, _to_chars_buffer));
+                    return;
+                }
+            }
+            write_attribute(_node, _attrib_name, _val);
+        }
+    }
 
     class XML_SERIALIZER_CLASS serializer_base
     {
@@ -62,15 +810,58 @@ namespace pugi_serializer
         void set_should_write_default_values(const bool _should_write_default_values);
         bool get_should_write_default_values();
 
+        // pool used by serialize_container_parallel, see reader::set_thread_pool
+        thread_pool* get_thread_pool() const;
+
+        // _observer is notified of every child(), attribute() and text() call of this serializer and the serializers
+        // created from it, or nullptr to stop. Without an observer nothing is measured. Used by reader, writer,
+        // stream_writer and binary_writer; binary_reader ignores it. The observer should outlive the serializer.
+        void set_observer(observer* _observer);
+
+        // spans of serialize_container and the other container functions are written to _tracer, or nullptr to stop.
+        // Used by all runtime serializers, and by the task_readers and fragment_writers created from them.
+        void set_tracer(trace_writer* _tracer);
+        trace_writer* get_tracer() const;
+
+        // memory resource given to new items by serialize_container and the other container functions,
+        // see reader::set_memory_resource. nullptr for writers.
+        std::pmr::memory_resource* get_memory_resource() const;
+
+        // index filled by serialize_id and serialize_ref, see reader::set_id_index. nullptr for writers.
+        id_index* get_id_index() const;
+
+        // document shared by reader(std::shared_ptr<pugi::xml_document>) and the task_readers created from it, or nullptr
+        std::shared_ptr<pugi::xml_document> document() const;
+
+        // true if curr_node() is a node of a pugi::xml_document. false for stream_writer, binary_writer and binary_reader,
+        // whose nodes are ids of their own elements
+        bool has_document_nodes() const;
+
+        // a copy of this reader's settings, to read its nodes later, see lazy. The same copy is returned
+        // while the settings do not change. nullptr for writers, binary_reader and the reader of a session,
+        // whose document is reset for the next message.
+        std::shared_ptr<const reader_settings> share_settings() const;
+
+        // write: the attributes, text, cdata and child elements of _src, as if they were serialized one by one
+        // read: nothing is done
+        void write_copy(pugi::xml_node _src);
+
         pugi::xml_node& curr_node() {return _curr_node;}
 
         void node_name(std::string& _name);
+        const char* node_name();
 
-        serializer_base child(const char* _name);
-        serializer_base next_sibling(const char* _name);
+        serializer_base child(const name_token& _name);
+        serializer_base next_sibling(const name_token& _name);
+
+        // unnamed iteration over element children, used to walk all children in one pass
+        // read: first/next element child regardless of name
+        // write: always return an empty serializer, there is nothing to iterate on
+        serializer_base first_child();
+        serializer_base next_sibling();
 
         template<typename TValue, typename TDefault>
-        serializer_base child_with_text(const char* _child_name, TValue& _value, const TDefault def)
+        serializer_base child_with_text(const name_token& _child_name, TValue& _value, const TDefault def)
         // write: will not create the child if _value==def, unless get_should_write_default_values() == true
         // read: read the text of the child, if either child does not exist or child's text is empty - return the default
         // using different types for value and default so, for example, child_with_text can be called with TValue=std::string, TDefault=const char*
@@ -99,7 +890,7 @@ namespace pugi_serializer
         }
  
         template<typename TValue, typename TDefault>
-        serializer_base child_with_attribute(const char* _child_name, const char* _attrib_name, TValue& _value, const TDefault def)
+        serializer_base child_with_attribute(const name_token& _child_name, const name_token& _attrib_name, TValue& _value, const TDefault def)
         // write: will not create the child adn the attribute if _value==def, unless get_should_write_default_values() == true
         // read: read the attribute of the child, if either child does not exist or attribute does not exists return the default
         {
@@ -152,17 +943,27 @@ namespace pugi_serializer
         void text(TToSerialize& _val, const TDefault def);
 
         template<typename TToSerialize>
-        void attribute(const char* _name, TToSerialize& _val);
+        void attribute(const name_token& _name, TToSerialize& _val);
         
         template<typename TToSerialize, typename TDefault>
-        void attribute(const char* _name, TToSerialize& _val, const TDefault def);
+        void attribute(const name_token& _name, TToSerialize& _val, const TDefault def);
+
+        // serialize many attributes of the current element:
+        //     ser.attributes({{"id", id}, {"population", population}, {"inflation", inflation, 0.0f}});
+        // read: all bindings are read in one walk over the element's attributes,
+        //       an attribute that does not exist gets its binding's default, or remains unchanged if there is no default
+        // write: attributes are appended in the order of the bindings, same as calling attribute() for each binding
+        void attributes(std::initializer_list<attribute_binding> _bindings);
 
         void cdata(std::string& _text);
 
    protected:
+        friend class task_reader;
+        friend class fragment_writer;
         serializer_base(pugi::xml_node node, impl::impl_base& in_implementor);
 
         pugi::xml_node     _curr_node;
+        pugi::xml_node     _last_child;   // last child returned by child(), lets the reader try the next sibling first
         impl::impl_base&   _implementor;
     };
 
@@ -172,31 +973,769 @@ namespace pugi_serializer
     public:
         writer(pugi::xml_document& doc, const char* doc_element_name);
         writer(pugi::xml_node node);
+        // resets the session and writes into its document, with the session's implementor instead of a new one, see session
+        writer(session& _session, const char* doc_element_name);
         ~writer();
+
+        // to_chars: numbers are written with std::to_chars instead of pugixml's set(),
+        // floats and doubles in the shortest form that reads back to the same value, e.g. 16 and not 16.000000000000001
+        // Default is false.
+        void set_should_use_to_chars(const bool _should_use_to_chars);
+        bool get_should_use_to_chars() const;
+
+        // when set, serialize_container_parallel writes items on the pool's threads.
+        // the pool is not owned by the writer. Default is nullptr.
+        void set_thread_pool(thread_pool* _pool);
     };
 
-    class XML_SERIALIZER_CLASS reader : public serializer_base
+    // writes with its own copy of another writer's settings, into a separate document or text buffer,
+    // so it can be used on another thread than that writer.
+    // append_to_parent() adds what was written as children of the other writer's current node; it should be called
+    // on the other writer's thread, in the order the children should appear.
+    // Used by serialize_container_parallel.
+    class XML_SERIALIZER_CLASS fragment_writer : public serializer_base
     {
     public:
-        reader(pugi::xml_document& doc);
-        reader(pugi::xml_node node);
-        ~reader();
+        fragment_writer(const serializer_base& _parent);
+        ~fragment_writer();
+        fragment_writer(const fragment_writer&) = delete;
+        fragment_writer& operator=(const fragment_writer&) = delete;
+
+        void append_to_parent();
+
+    private:
+        impl::impl_base& _parent_implementor;
+        pugi::xml_node _parent_node;
     };
 
-    class serialized_base
+    // writes into a document that already has content, e.g. the document the values were read from,
+    // changing only what differs from what is written:
+    // - an element is matched with the first existing child of the same name that was not written yet
+    // - text and attribute values are compared, as text, with what would be written, and set only if different
+    // - missing elements and attributes are added, elements, text and attributes that were not written are removed by finish()
+    // Comments, processing instructions and the like are kept.
+    // get_update_stats().touched() is 0 if the document is unchanged, e.g. to skip saving it.
+    class XML_SERIALIZER_CLASS update_writer : public serializer_base
     {
     public:
-        virtual ~serialized_base() = default;
-        virtual void serialize(pugi_serializer::serializer_base& ser) = 0;
-        friend std::strong_ordering operator<=>(const pugi_serializer::serialized_base&,
-                                const pugi_serializer::serialized_base&);
-         friend bool operator==(const pugi_serializer::serialized_base&,
-                                const pugi_serializer::serialized_base&);
-    };
+        // updates doc's document element, which is renamed to doc_element_name if needed, or added if doc is empty
+        update_writer(pugi::xml_document& doc, const char* doc_element_name);
+        update_writer(pugi::xml_node node);
+        ~update_writer();
+
+        // remove what was not written, called by the destructor.
+        // nothing should be written after finish().
+        void finish();
+
+        // complete after finish()
+        const update_stats& get_update_stats() const;
+
+        // same as writer::set_should_use_to_chars, should be the same as when the document was written
+        void set_should_use_to_chars(const bool _should_use_to_chars);
+        bool get_should_use_to_chars() const;
+    };
+
+    // writes xml text directly to a std::string, std::ostream or file descriptor, without building a pugi::xml_document.
+    // The output is the same as writing with writer and saving the document with xml_document::save(out, _indent, _flags).
+    // Supported flags are pugi::format_indent, format_raw, format_no_declaration and format_no_empty_element_tags.
+    // Elements are written as they are created, so:
+    // - an element's attributes should be written before its children
+    // - once a sibling or a parent's sibling was created, the element cannot be written to anymore
+    // calls that break these rules are not written and are counted by get_out_of_order_count().
+    // curr_node() of a stream_writer is not a real pugixml node and should not be used.
+    class XML_SERIALIZER_CLASS stream_writer : public serializer_base
+    {
+    public:
+        // xml is appended to _out
+        stream_writer(std::string& _out, const char* doc_element_name, const char* _indent = "\t", const unsigned int _flags = pugi::format_default);
+        stream_writer(std::ostream& _out, const char* doc_element_name, const char* _indent = "\t", const unsigned int _flags = pugi::format_default);
+        stream_writer(int _fd, const char* doc_element_name, const char* _indent = "\t", const unsigned int _flags = pugi::format_default);
+        ~stream_writer();
+
+        // close all open elements and write what's left to the output, called by the destructor.
+        // nothing can be written after finish().
+        void finish();
+
+        // same as writer::set_should_use_to_chars
+        void set_should_use_to_chars(const bool _should_use_to_chars);
+        bool get_should_use_to_chars() const;
+        size_t get_out_of_order_count() const;
+
+        // same as writer::set_thread_pool
+        void set_thread_pool(thread_pool* _pool);
+    };
+
+    // writes a compact binary encoding instead of xml, with the same serialize functions, to be read by binary_reader.
+    // Element and attribute names are written once, and numbers are written as raw little-endian values.
+    // Elements are kept in memory until finish(), so they can be written in any order, same as with writer.
+    // curr_node() of a binary_writer is not a real pugixml node and should not be used.
+    class XML_SERIALIZER_CLASS binary_writer : public serializer_base
+    {
+    public:
+        binary_writer(std::string& _out, const char* doc_element_name);
+        ~binary_writer();
+
+        // append the encoding to _out, called by the destructor.
+        // nothing can be written after finish().
+        void finish();
+    };
+
+    // reads the encoding written by binary_writer.
+    // _data is not copied and should remain valid while the reader is used, std::string_view values point into it.
+    // A value is converted if it's read as a different type than it was written, e.g. a number written as a string.
+    // curr_node() of a binary_reader is not a real pugixml node and should not be used.
+    class XML_SERIALIZER_CLASS binary_reader : public serializer_base
+    {
+    public:
+        binary_reader(const void* _data, const size_t _size);
+        binary_reader(const std::string& _data);
+        ~binary_reader();
+
+        // status_ok, or which part of the encoding is not valid, in which case nothing is read
+        pugi::xml_parse_status status() const;
+    };
+
+    class XML_SERIALIZER_CLASS reader : public serializer_base
+    {
+    public:
+        reader(pugi::xml_document& doc);
+        reader(pugi::xml_node node);
+        // the reader shares ownership of the document, so std::string_view values read by text()/attribute()
+        // remain valid as long as the document returned by document() is kept alive
+        reader(std::shared_ptr<pugi::xml_document> doc);
+        // reads the session's document, with the session's implementor instead of a new one, see session
+        reader(session& _session);
+        ~reader();
+
+        // ordered lookup: child(name) first tries the sibling after the child previously returned by the same serializer,
+        // and only if that sibling has a different name, searches from the first child.
+        // When fields are read in the same order they were written, each lookup is O(1).
+        // Note that with ordered lookup, calling child(name) twice with the same name will return
+        // the 2nd element with that name, if it immediately follows the first, so it should be used
+        // only when each name is read once per parent, or repeated names are read with next_sibling(name).
+        // Default is false.
+        void set_should_use_ordered_lookup(const bool _should_use_ordered_lookup);
+        bool get_should_use_ordered_lookup() const;
+        lookup_stats get_lookup_stats() const;
+
+        // plans: the attribute() and child() calls made for the first element with a given name are recorded,
+        // with the position of each attribute and child found. For later elements with the same name,
+        // each call first tries the planned position, and falls back to a normal lookup if the calls or the
+        // element differ from the plan. Useful for containers of many items with the same attributes and children.
+        // child(name) returns the same child as without plans: only the children between the last child returned
+        // and the planned position are compared, and a normal lookup is done if an earlier child may have the same name.
+        // When used, plans replace ordered lookup. Default is false.
+        void set_should_use_plans(const bool _should_use_plans);
+        bool get_should_use_plans() const;
+        plan_stats get_plan_stats() const;
+
+        // from_chars: numbers are read with std::from_chars instead of pugixml's as_int(), as_double(), etc.
+        // Parsing is locale independent, and only decimal or 0x hex integers and decimal floating point are accepted.
+        // Text that is not a number, or is out of range for the type, is read as 0 and recorded in get_parse_errors().
+        // Empty text is read as 0 and is not an error.
+        // Default is false.
+        void set_should_use_from_chars(const bool _should_use_from_chars);
+        bool get_should_use_from_chars() const;
+        const std::vector<number_parse_error>& get_parse_errors() const;
+
+        // when set, serialize_container_parallel reads items on the pool's threads.
+        // the pool is not owned by the reader. Default is nullptr.
+        void set_thread_pool(thread_pool* _pool);
+
+        // items created by serialize_container and the other container functions are constructed with
+        // a std::pmr::polymorphic_allocator using _resource, if they use one and their container does not give them
+        // its own, e.g. a std::vector of items whose allocator_type is std::pmr::polymorphic_allocator.
+        // Items of std::pmr containers use the container's resource.
+        // std::pmr::string values are copied into the string's own resource.
+        // The resource is not owned by the reader. Default is nullptr: items are default constructed.
+        void set_memory_resource(std::pmr::memory_resource* _resource);
+
+        // serialize_id adds the objects it reads to _index, and serialize_ref adds the refs it reads,
+        // to be bound by _index->resolve() when reading is done:
+        //     pugi_serializer::id_index index;
+        //     xml_reader.set_id_index(&index);
+        //     a_world.serialize(xml_reader);
+        //     index.resolve();
+        // Also used by the task_readers of serialize_container_parallel.
+        // The index is not owned by the reader. Default is nullptr: ids and refs are only read.
+        void set_id_index(id_index* _index);
+    };
+
+    // the settings of a reader, kept after the reader is destroyed, see serializer_base::share_settings.
+    // Pointers among them, e.g. the id_index or memory resource, are not owned.
+    class XML_SERIALIZER_CLASS reader_settings
+    {
+    public:
+        explicit reader_settings(impl::impl_base* _settings) : _settings(_settings) {}
+        ~reader_settings();
+        reader_settings(const reader_settings&) = delete;
+        reader_settings& operator=(const reader_settings&) = delete;
+
+    private:
+        friend class task_reader;
+        friend class impl::reader_impl;
+        impl::impl_base* _settings;
+    };
+
+    // reads with its own copy of another reader's settings, so it can be used on another thread than that reader.
+    // Lookup stats and parse errors are added to the other reader when the task_reader is destroyed.
+    // Used by serialize_container_parallel.
+    class XML_SERIALIZER_CLASS task_reader : public serializer_base
+    {
+    public:
+        task_reader(const serializer_base& _parent);
+        // reads _node with a copy of _settings, used by lazy. Lookup stats and parse errors are not kept
+        task_reader(const reader_settings& _settings, pugi::xml_node _node);
+        ~task_reader();
+        task_reader(const task_reader&) = delete;
+        task_reader& operator=(const task_reader&) = delete;
+
+        // start reading another node
+        void set_node(pugi::xml_node node)
+        {
+            _curr_node = node;
+            _last_child = pugi::xml_node();
+        }
+
+    private:
+        impl::impl_base* _parent_implementor;
+    };
+
+    // hints for load_mapped_file, passed to madvise where available
+    const unsigned int map_hint_none = 0;
+    const unsigned int map_hint_sequential = 1;     // MADV_SEQUENTIAL: the file is read from start to end
+    const unsigned int map_hint_hugepages = 2;      // MADV_HUGEPAGE: back the mapping with huge pages, Linux only
+    const unsigned int map_hint_default = map_hint_sequential;
+
+    // parse a file in place from a private memory mapping, instead of reading it into a buffer allocated by pugixml.
+    // The returned document owns the mapping, and can be passed to reader(std::shared_ptr<pugi::xml_document>):
+    //     pugi_serializer::reader xml_reader(pugi_serializer::load_mapped_file("mondial.xml"));
+    // If the file cannot be mapped, it's loaded with xml_document::load_file.
+    // Never returns nullptr, _result receives the result of parsing.
+    std::shared_ptr<pugi::xml_document> XML_SERIALIZER_FUNCTION load_mapped_file(const char* path,
+                                                                                const unsigned int parse_options = pugi::parse_default,
+                                                                                const unsigned int map_hints = map_hint_default,
+                                                                                pugi::xml_parse_result* _result = nullptr);
+
+    // reads a document whose root has many children, e.g. a large export, without loading the whole document.
+    // The xml is read in chunks, and each child of the root is parsed into its own small document when it's reached,
+    // so memory is bounded by the size of the largest child rather than the size of the document.
+    // Input is expected to be UTF-8.
+    class XML_SERIALIZER_CLASS stream_reader
+    {
+    public:
+        stream_reader(std::istream& in, const unsigned int parse_options = pugi::parse_default);
+        stream_reader(const char* data, const size_t size, const unsigned int parse_options = pugi::parse_default);
+        ~stream_reader();
+        stream_reader(const stream_reader&) = delete;
+        stream_reader& operator=(const stream_reader&) = delete;
+
+        // the root element with its attributes but without children, or empty node if there is no root element
+        pugi::xml_node root() const;
+
+        // the next child element of the root, valid until the next call to next_item().
+        // return empty node after the last child, or if the xml could not be read, see status()
+        pugi::xml_node next_item();
+
+        // status_ok, unless the xml could not be read
+        pugi::xml_parse_status status() const;
+
+        // call _func(serializer_base& item_ser) for each remaining child element of the root, return the number of children
+        template<typename TFunc>
+        size_t for_each_item(TFunc&& _func)
+        {
+            size_t num_items = 0;
+            for (pugi::xml_node item = next_item(); item; item = next_item())
+            {
+                reader item_reader(item);
+                _func(static_cast<serializer_base&>(item_reader));
+                ++num_items;
+            }
+            return num_items;
+        }
+
+    private:
+        impl::item_scanner* _scanner;
+    };
+
+    // a document and the reader and writer implementors, to be reused for many small documents, e.g. one per message.
+    // Once install_memory_functions() was called, the document's memory pages are allocated from an arena owned by
+    // the session, and reset() rewinds the arena, so after the first messages, loading, reading and writing a message
+    // does not allocate memory:
+    //     pugi_serializer::session::install_memory_functions();     // at startup
+    //     pugi_serializer::session a_session;
+    //     for (const std::string& message : messages)
+    //     {
+    //         a_session.load_buffer(message.data(), message.size());
+    //         pugi_serializer::reader xml_reader(a_session);
+    //         order.serialize(xml_reader);
+    //     }
+    // Without install_memory_functions(), the session still reuses its document and implementors, but the document
+    // allocates its pages like other documents.
+    // The document should be loaded, written and reset on the thread that created the session,
+    // and a session can have one reader and one writer at a time.
+    class XML_SERIALIZER_CLASS session
+    {
+    public:
+        // _arena_capacity: size of the arena's first block, more blocks are added when needed and kept by reset()
+        // _use_huge_pages: back the arena with huge pages where available, Linux only
+        explicit session(const size_t _arena_capacity = 1024 * 1024, const bool _use_huge_pages = false);
+        ~session();
+        session(const session&) = delete;
+        session& operator=(const session&) = delete;
+
+        // replace pugixml's memory functions with ones that allocate the documents of sessions from their arenas.
+        // Should be called once at startup, before pugixml allocates anything and while no other thread uses pugixml,
+        // since memory allocated before cannot be freed by the new functions, and after any call to
+        // pugi::set_memory_management_functions, whose functions are still used for other memory.
+        // Other documents then pay one header of alignof(std::max_align_t) bytes per allocation.
+        static void install_memory_functions();
+
+        pugi::xml_document& document();
+
+        // empty the document and rewind the arena, keeping its capacity
+        void reset();
+
+        // reset() and load the document, same as the pugi::xml_document functions
+        pugi::xml_parse_result load_buffer(const void* contents, const size_t size, const unsigned int parse_options = pugi::parse_default);
+        pugi::xml_parse_result load_string(const char* contents, const unsigned int parse_options = pugi::parse_default);
+        pugi::xml_parse_result load_file(const char* path, const unsigned int parse_options = pugi::parse_default);
+
+        // bytes of the arena's blocks, and bytes allocated since the last reset()
+        size_t arena_capacity() const;
+        size_t arena_used() const;
+
+    private:
+        friend class reader;
+        friend class writer;
+        impl::session_state* _state;
+    };
+
+    // compile-time modes for basic_serializer
+    struct read_mode { static constexpr bool is_reading = true; };
+    struct write_mode { static constexpr bool is_reading = false; };
+
+    namespace impl
+    {
+        // settings and counters shared by a static_reader/static_writer and all the serializers created from it
+        struct static_state
+        {
+            bool write_default_values = true;
+            bool use_ordered_lookup = false;
+            bool use_from_chars = false;
+            bool use_to_chars = false;
+            lookup_stats stats;
+            std::vector<number_parse_error> parse_errors;
+            char to_chars_buffer[to_chars_buffer_size];
+
+            std::vector<number_parse_error>* number_errors() { return use_from_chars ? &parse_errors : nullptr; }
+            char* number_buffer() { return use_to_chars ? to_chars_buffer : nullptr; }
+        };
+    }
+
+    // Same interface as serializer_base, but reading or writing is decided at compile time by TMode,
+    // so there are no virtual calls and the reading or writing code is inlined into the calling serialize function.
+    // To be used with both basic_serializer and serializer_base, serialize functions should be templates:
+    //     template<typename TSERIALIZER>
+    //     void serialize(TSERIALIZER& ser) {...}
+    // Use static_reader/static_writer to create a basic_serializer.
+    template<typename TMode>
+    class basic_serializer
+    {
+    public:
+        using mode_type = TMode;
+
+        basic_serializer(const basic_serializer&) = default;
+        basic_serializer& operator=(const basic_serializer&) = default;
+
+        operator bool() const { return bool(_curr_node); }
+        static constexpr bool reading() { return TMode::is_reading; }
+        static constexpr bool writing() { return !TMode::is_reading; }
+        void set_should_write_default_values(const bool _should_write_default_values) { _state->write_default_values = _should_write_default_values; }
+        bool get_should_write_default_values() { return _state->write_default_values; }
+
+        pugi::xml_node& curr_node() {return _curr_node;}
+
+        void node_name(std::string& _name)
+        {
+            if constexpr (reading())
+                _name = _curr_node.name();
+            else
+                _curr_node.set_name(_name.c_str());
+        }
+
+        const char* node_name() { return _curr_node.name(); }
+
+        basic_serializer child(const name_token& _name)
+        {
+            if constexpr (reading())
+            {
+                if (_state->use_ordered_lookup)
+                    return basic_serializer(impl::find_child_ordered(_curr_node, _name, _last_child, _state->stats), _state);
+                else
+                    return basic_serializer(impl::find_child(_curr_node, _name), _state);
+            }
+            else
+                return basic_serializer(impl::append_child(_curr_node, _name), _state);
+        }
+
+        basic_serializer next_sibling(const name_token& _name)
+        {
+            if constexpr (reading())
+                return basic_serializer(impl::find_next_sibling(_curr_node, _name), _state);
+            else
+                return basic_serializer(_curr_node.parent().insert_child_after(_name.c_str(), _curr_node), _state);
+        }
+
+        basic_serializer first_child()
+        {
+            if constexpr (reading())
+                return basic_serializer(impl::first_element_child(_curr_node), _state);
+            else
+                return basic_serializer(pugi::xml_node(), _state);
+        }
+
+        basic_serializer next_sibling()
+        {
+            if constexpr (reading())
+                return basic_serializer(impl::next_element_sibling(_curr_node), _state);
+            else
+                return basic_serializer(pugi::xml_node(), _state);
+        }
+
+        template<typename TValue, typename TDefault>
+        basic_serializer child_with_text(const name_token& _child_name, TValue& _value, const TDefault def)
+        // same as serializer_base::child_with_text
+        {
+            if (reading() || get_should_write_default_values() || _value != def)
+            {
+                auto return_serializer = child(_child_name);
+                if constexpr (reading())
+                    return_serializer.text(_value, def);
+                else
+                    return_serializer.text(_value);
+                return return_serializer;
+            }
+            else
+                return basic_serializer(pugi::xml_node(), _state);
+        }
+
+        template<typename TValue, typename TDefault>
+        basic_serializer child_with_attribute(const name_token& _child_name, const name_token& _attrib_name, TValue& _value, const TDefault def)
+        // same as serializer_base::child_with_attribute
+        {
+            if (reading() || get_should_write_default_values() || _value != def)
+            {
+                auto return_serializer = child(_child_name);
+                return_serializer.attribute(_attrib_name, _value, def);
+                return return_serializer;
+            }
+            else
+                return basic_serializer(pugi::xml_node(), _state);
+        }
+
+        const char* c_str(const char* _c_str)
+        {
+            if constexpr (reading())
+                return _curr_node.text().as_string();
+            else
+            {
+                _curr_node.text().set(_c_str);
+                return _c_str;
+            }
+        }
+
+        template<typename TSTR>
+        void serialize_string(TSTR& in_out_string)
+        {
+            in_out_string = c_str(in_out_string.c_str());
+        }
+
+        template<typename TToSerialize>
+        void text(TToSerialize& _val)
+        {
+            if constexpr (reading())
+                impl::read_text(_curr_node, _val, _state->number_errors());
+            else
+                impl::write_text(_curr_node, _val, _state->number_buffer());
+        }
+
+        template<typename TToSerialize, typename TDefault>
+        void text(TToSerialize& _val, const TDefault def)
+        {
+            if constexpr (reading())
+                impl::read_text_with_default(_curr_node, _val, def, _state->number_errors());
+            else if constexpr (std::is_same_v<TToSerialize, std::string>)
+            {
+                // same as writer_impl: default text is never written
+                if (_val != def)
+                    impl::write_text(_curr_node, _val);
+            }
+            else if (_state->write_default_values || _val != def)
+                impl::write_text(_curr_node, _val, _state->number_buffer());
+        }
+
+        template<typename TToSerialize>
+        void attribute(const name_token& _name, TToSerialize& _val)
+        {
+            if constexpr (reading())
+                impl::read_attribute(_curr_node, _name, _val, _state->number_errors());
+            else
+                impl::write_attribute(_curr_node, _name, _val, _state->number_buffer());
+        }
+
+        template<typename TToSerialize, typename TDefault>
+        void attribute(const name_token& _name, TToSerialize& _val, const TDefault def)
+        {
+            if constexpr (reading())
+                impl::read_attribute_with_default(_curr_node, _name, _val, def, _state->number_errors());
+            else if (_state->write_default_values || _val != def)
+                impl::write_attribute(_curr_node, _name, _val, _state->number_buffer());
+        }
+
+        // same as serializer_base::attributes
+        void attributes(std::initializer_list<attribute_binding> _bindings)
+        {
+            if constexpr (reading())
+                impl::read_attributes(_curr_node, _bindings.begin(), _bindings.size(), _state->number_errors());
+            else
+            {
+                for (const attribute_binding& binding : _bindings)
+                {
+                    binding.visit([&](auto& _val, auto def)
+                    {
+                        if (binding.has_default)
+                            attribute(binding.name, _val, def);
+                        else
+                            attribute(binding.name, _val);
+                    });
+                }
+            }
+        }
+
+        void cdata(std::string& _text)
+        {
+            if constexpr (reading())
+                _text = _curr_node.child_value();
+            else
+                _curr_node.append_child(pugi::node_cdata).set_value(_text.c_str());
+        }
+
+    protected:
+        basic_serializer(pugi::xml_node node, impl::static_state* in_state)
+        : _curr_node(node)
+        , _state(in_state)
+        {}
+
+        pugi::xml_node        _curr_node;
+        pugi::xml_node        _last_child;
+        impl::static_state*   _state;
+    };
+
+    class static_writer : public basic_serializer<write_mode>
+    {
+    public:
+        static_writer(pugi::xml_document& doc, const char* doc_element_name)
+        : basic_serializer<write_mode>(doc.append_child(doc_element_name), &_static_state) {}
+        static_writer(pugi::xml_node node)
+        : basic_serializer<write_mode>(node, &_static_state) {}
+        static_writer(const static_writer&) = delete;
+        static_writer& operator=(const static_writer&) = delete;
+
+        // same as writer::set_should_use_to_chars
+        void set_should_use_to_chars(const bool _should_use_to_chars) { _static_state.use_to_chars = _should_use_to_chars; }
+        bool get_should_use_to_chars() const { return _static_state.use_to_chars; }
+
+    private:
+        impl::static_state _static_state;
+    };
+
+    class static_reader : public basic_serializer<read_mode>
+    {
+    public:
+        static_reader(pugi::xml_document& doc)
+        : basic_serializer<read_mode>(doc.document_element(), &_static_state) {}
+        static_reader(pugi::xml_node node)
+        : basic_serializer<read_mode>(node, &_static_state) {}
+        // same as reader(std::shared_ptr<pugi::xml_document>)
+        static_reader(std::shared_ptr<pugi::xml_document> doc)
+        : basic_serializer<read_mode>(doc->document_element(), &_static_state)
+        , _doc(std::move(doc)) {}
+        static_reader(const static_reader&) = delete;
+        static_reader& operator=(const static_reader&) = delete;
+
+        // same as reader::set_should_use_ordered_lookup
+        void set_should_use_ordered_lookup(const bool _should_use_ordered_lookup) { _static_state.use_ordered_lookup = _should_use_ordered_lookup; }
+        bool get_should_use_ordered_lookup() const { return _static_state.use_ordered_lookup; }
+        lookup_stats get_lookup_stats() const { return _static_state.stats; }
+        // same as reader::set_should_use_from_chars
+        void set_should_use_from_chars(const bool _should_use_from_chars) { _static_state.use_from_chars = _should_use_from_chars; }
+        bool get_should_use_from_chars() const { return _static_state.use_from_chars; }
+        const std::vector<number_parse_error>& get_parse_errors() const { return _static_state.parse_errors; }
+        std::shared_ptr<pugi::xml_document> document() const { return _doc; }
+
+    private:
+        impl::static_state _static_state;
+        std::shared_ptr<pugi::xml_document> _doc;
+    };
+
+    class serialized_base
+    {
+    public:
+        virtual ~serialized_base() = default;
+        virtual void serialize(pugi_serializer::serializer_base& ser) = 0;
+        friend std::strong_ordering operator<=>(const pugi_serializer::serialized_base&,
+                                const pugi_serializer::serialized_base&);
+         friend bool operator==(const pugi_serializer::serialized_base&,
+                                const pugi_serializer::serialized_base&);
+    };
     
+    // a T that is read from its element only when it's first used, e.g. in a container of items
+    // of which few are used:
+    //     std::vector<pugi_serializer::lazy<country>> country_vec;
+    //     serialize_container(ser, country_vec, "country");
+    //     country_vec[12]->name;     // only this country is read
+    // read: the element is kept, and T::serialize is called by the first get(), with the settings the reader had,
+    //       see serializer_base::share_settings. The document, and the id_index and memory resource if any,
+    //       should outlive the lazy value, or the document be shared, see reader(std::shared_ptr<pugi::xml_document>).
+    //       Refs read by get() are added to the id_index after its resolve(), which should be called again.
+    //       Serializers without document nodes, e.g. binary_reader, and readers of a session read T right away.
+    // write: a T that was never read is written as a copy of its element, see serializer_base::write_copy,
+    //        otherwise T::serialize is called.
+    // get() can be called from several threads, T is read once. Copies and moves wait for a load in progress.
+    template<typename T>
+    class lazy
+    {
+    public:
+        lazy() = default;
+        lazy(T _value) : _value(std::move(_value)), _loaded(true) {}
+
+        // other's mutex is held while it is copied or moved, other can be loading in another thread
+        lazy(const lazy& other) : lazy(other, std::lock_guard<std::mutex>(other._load_mutex)) {}
+        lazy(lazy&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : lazy(std::move(other), std::lock_guard<std::mutex>(other._load_mutex)) {}
+
+        lazy& operator=(const lazy& other)
+        {
+            if (this != &other)
+            {
+                std::scoped_lock lock(_load_mutex, other._load_mutex);
+                _node = other._node;
+                _settings = other._settings;
+                _value = other._value;
+                _loaded.store(other._loaded.load(std::memory_order_relaxed), std::memory_order_release);
+            }
+            return *this;
+        }
+
+        lazy& operator=(lazy&& other) noexcept(std::is_nothrow_move_assignable_v<T>)
+        {
+            if (this != &other)
+            {
+                std::scoped_lock lock(_load_mutex, other._load_mutex);
+                _node = other._node;
+                _settings = std::move(other._settings);
+                _value = std::move(other._value);
+                _loaded.store(other._loaded.load(std::memory_order_relaxed), std::memory_order_release);
+            }
+            return *this;
+        }
+
+        T& get()
+        {
+            if (!_loaded.load(std::memory_order_acquire)) [[unlikely]]
+                load();
+            return _value;
+        }
+        const T& get() const { return const_cast<lazy*>(this)->get(); }
+
+        T& operator*() { return get(); }
+        const T& operator*() const { return get(); }
+        T* operator->() { return &get(); }
+        const T* operator->() const { return &get(); }
+
+        // false while the element was not read yet
+        bool is_loaded() const { return _loaded.load(std::memory_order_acquire); }
+
+        // element the value is read from, empty once it was read
+        pugi::xml_node node() const { return _node; }
+
+        void serialize(serializer_base& ser)
+        {
+            if (ser.reading())
+            {
+                _value = T();
+                if (std::shared_ptr<const reader_settings> settings = ser.share_settings())
+                {
+                    _node = ser.curr_node();
+                    _settings = std::move(settings);
+                    _loaded.store(false, std::memory_order_release);
+                }
+                else
+                {
+                    _value.serialize(ser);
+                    _loaded.store(true, std::memory_order_release);
+                }
+            }
+            else if (is_loaded() || !_node)
+                _value.serialize(ser);
+            else
+                ser.write_copy(_node);
+        }
+
+        // static_reader/static_writer have no settings to share: read: T is read right away,
+        // write: a T that was never read is read first, then T::serialize is called
+        template<typename TMode>
+        void serialize(basic_serializer<TMode>& ser)
+        {
+            if constexpr (basic_serializer<TMode>::reading())
+            {
+                std::lock_guard<std::mutex> lock(_load_mutex);
+                _value = T();
+                _value.serialize(ser);
+                _node = pugi::xml_node();
+                _settings.reset();
+                _loaded.store(true, std::memory_order_release);
+            }
+            else
+                get().serialize(ser);
+        }
+
+        friend bool operator==(const lazy& _left, const lazy& _right) { return _left.get() == _right.get(); }
+
+    private:
+        lazy(const lazy& other, const std::lock_guard<std::mutex>&)
+        : _node(other._node), _settings(other._settings), _value(other._value), _loaded(other._loaded.load(std::memory_order_relaxed))
+        {}
+
+        lazy(lazy&& other, const std::lock_guard<std::mutex>&)
+        : _node(other._node), _settings(std::move(other._settings)), _value(std::move(other._value)), _loaded(other._loaded.load(std::memory_order_relaxed))
+        {}
+
+        void load()
+        {
+            std::lock_guard<std::mutex> lock(_load_mutex);
+            if (_loaded.load(std::memory_order_relaxed))
+                return;
+            if (_node)
+            {
+                task_reader node_reader(*_settings, _node);
+                _value.serialize(static_cast<serializer_base&>(node_reader));
+            }
+            _node = pugi::xml_node();
+            _settings.reset();
+            _loaded.store(true, std::memory_order_release);
+        }
+
+        pugi::xml_node _node;
+        std::shared_ptr<const reader_settings> _settings;  // also keeps _node valid when the document is shared
+        T _value{};
+        std::atomic<bool> _loaded{true};            // a default lazy has nothing to read
+        mutable std::mutex _load_mutex;
+    };
+
     // serialize an array of string objects
-    template<typename TSTR>
-    void serialize_string_array(pugi_serializer::serializer_base& ser, TSTR* array_begin, TSTR* array_end, const char* container_item_name)
+    template<typename TSERIALIZER, typename TSTR>
+    void serialize_string_array(TSERIALIZER& ser, TSTR* array_begin, TSTR* array_end, const name_token& container_item_name)
     {
         if (ser.reading())
         {
@@ -219,8 +1758,8 @@ namespace pugi_serializer
     // serialize an array of objects derived from pugi_serializer::serialized_base
     // write: iterate from array_begin to array_end, cretae element named container_item_name for for each and call T_ITEM.serialize on new element
     // read: iterate on all elements named container_item_name and serialize each into a new T_ITEM, but no more than array_end-array_begin times
-    template<typename T_ITEM>
-    void serialize_array(pugi_serializer::serializer_base& ser, T_ITEM* array_begin, T_ITEM* array_end, const char* container_item_name)
+    template<typename TSERIALIZER, typename T_ITEM>
+    void serialize_array(TSERIALIZER& ser, T_ITEM* array_begin, T_ITEM* array_end, const name_token& container_item_name)
     {
         if (ser.reading())
         {
@@ -242,29 +1781,566 @@ namespace pugi_serializer
         }
     }
 
+    namespace impl
+    {
+        // room for num_items more items. Capacity still grows geometrically when a container is
+        // appended to many times, e.g. by serialize_container called for several parents
+        template<typename TCONTAINER>
+        void reserve_if_possible(TCONTAINER& in_container, const size_t num_items)
+        {
+            if constexpr (requires { in_container.capacity(); in_container.reserve(num_items); })
+            {
+                const size_t needed = in_container.size() + num_items;
+                if (needed > in_container.capacity())
+                    in_container.reserve(std::max<size_t>(needed, in_container.capacity() * 2));
+            }
+            else if constexpr (requires { in_container.reserve(num_items); })
+            {
+                if (in_container.empty())
+                    in_container.reserve(num_items);
+            }
+        }
+
+        using pmr_allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+        template<typename TSERIALIZER>
+        std::pmr::memory_resource* memory_resource_of(TSERIALIZER& ser)
+        {
+            if constexpr (std::is_base_of_v<serializer_base, TSERIALIZER>)
+                return ser.get_memory_resource();
+            else
+                return nullptr;
+        }
+
+        // a new item, using _resource if TITEM uses a std::pmr allocator
+        template<typename TITEM>
+        TITEM make_item(std::pmr::memory_resource* _resource)
+        {
+            if constexpr (std::uses_allocator_v<TITEM, pmr_allocator>)
+            {
+                if (nullptr != _resource)
+                    return std::make_obj_using_allocator<TITEM>(pmr_allocator(_resource));
+            }
+            return TITEM();
+        }
+
+        // append a new item to in_container, see reader::set_memory_resource.
+        // Items of std::pmr containers get the container's resource from emplace_back()
+        template<typename TCONTAINER>
+        typename TCONTAINER::value_type& emplace_item(TCONTAINER& in_container, std::pmr::memory_resource* _resource)
+        {
+            using item_type = typename TCONTAINER::value_type;
+            if constexpr (std::uses_allocator_v<item_type, pmr_allocator> && !std::uses_allocator_v<TCONTAINER, pmr_allocator>)
+            {
+                if (nullptr != _resource)
+                    return in_container.emplace_back(make_item<item_type>(_resource));
+            }
+            return in_container.emplace_back();
+        }
+
+        // number of children of _node named _name
+        inline size_t count_children(pugi::xml_node _node, const name_token& _name)
+        {
+            size_t num_children = 0;
+            for (auto node = find_child(_node, _name); node; node = find_next_sibling(node, _name))
+                ++num_children;
+            return num_children;
+        }
+
+        // number of items to reserve before reading the children of ser named _name.
+        // 0 when the serializer's nodes are not document nodes, e.g. binary_reader, whose items are not counted in advance
+        template<typename TSERIALIZER>
+        size_t count_items(TSERIALIZER& ser, const name_token& _name)
+        {
+            if constexpr (std::is_base_of_v<serializer_base, TSERIALIZER>)
+            {
+                if (!ser.has_document_nodes())
+                    return 0;
+            }
+            return count_children(ser.curr_node(), _name);
+        }
+
+        // return the index of _name in _names, or _num_names if not found
+        inline size_t find_item_name(const name_token* _names, const size_t _num_names, const char* _name)
+        {
+            for (size_t i = 0; i < _num_names; ++i)
+            {
+                if (_names[i].matches(_name))
+                    return i;
+            }
+            return _num_names;
+        }
+
+        template<typename TSERIALIZER>
+        id_index* id_index_of(TSERIALIZER& ser)
+        {
+            if constexpr (std::is_base_of_v<serializer_base, TSERIALIZER>)
+                return ser.get_id_index();
+            else
+                return nullptr;
+        }
+
+        // in debug builds, when the serializer has an id_index, asserts that reading items into a container did not
+        // reallocate it, which would move the items already added to the index, see id_index
+        template<typename TCONTAINER>
+        class items_not_moved
+        {
+        public:
+            template<typename TSERIALIZER>
+            items_not_moved([[maybe_unused]] TSERIALIZER& ser, TCONTAINER& in_container)
+            : _container(in_container)
+            {
+#ifndef NDEBUG
+                if constexpr (requires { in_container.data(); })
+                {
+                    _checked = nullptr != id_index_of(ser);
+                    _had_items = !in_container.empty();
+                    _data = in_container.data();
+                }
+#endif
+            }
+
+            // the container was reserved for the items to read: only items it already had should not move
+            void reserved()
+            {
+#ifndef NDEBUG
+                if constexpr (requires { _container.data(); })
+                    if (!_had_items)
+                        _data = _container.data();
+#endif
+            }
+
+            ~items_not_moved()
+            {
+#ifndef NDEBUG
+                if constexpr (requires { _container.data(); })
+                    assert((!_checked || _data == _container.data())
+                           && "items added to an id_index were moved: reserve the container for all its items before reading");
+#endif
+            }
+
+        private:
+            TCONTAINER& _container;
+            [[maybe_unused]] const void* _data = nullptr;
+            [[maybe_unused]] bool _checked = false;
+            [[maybe_unused]] bool _had_items = false;
+        };
+    }
+
+    // read or write _id as attribute _attrib_name.
+    // read: if the serializer has an id_index, _object is added to it with _id, unless _id is empty
+    template<typename TSERIALIZER, typename T>
+    void serialize_id(TSERIALIZER& ser, const name_token& _attrib_name, std::string& _id, T& _object)
+    {
+        ser.attribute(_attrib_name, _id);
+        if (ser.reading() && !_id.empty())
+        {
+            if (id_index* index = impl::id_index_of(ser); nullptr != index)
+                index->add(_id, _object);
+        }
+    }
+
+    // read or write the id of _ref as attribute _attrib_name.
+    // read: _ref is unbound, and if the serializer has an id_index, added to it to be bound by id_index::resolve()
+    template<typename TSERIALIZER, typename T>
+    void serialize_ref(TSERIALIZER& ser, const name_token& _attrib_name, ref<T>& _ref)
+    {
+        ser.attribute(_attrib_name, _ref._id);
+        if (ser.reading())
+        {
+            _ref._target = nullptr;
+            if (id_index* index = impl::id_index_of(ser); nullptr != index && !_ref._id.empty())
+                index->add_ref(_ref);
+        }
+    }
+
+    // same, with a default id: read: if there is no attribute, the id is default_id, write: skipped if the id is default_id
+    template<typename TSERIALIZER, typename T>
+    void serialize_ref(TSERIALIZER& ser, const name_token& _attrib_name, ref<T>& _ref, const std::string_view default_id)
+    {
+        ser.attribute(_attrib_name, _ref._id, default_id);
+        if (ser.reading())
+        {
+            _ref._target = nullptr;
+            if (id_index* index = impl::id_index_of(ser); nullptr != index && !_ref._id.empty())
+                index->add_ref(_ref);
+        }
+    }
+
     // serialize a container of objects derived from pugi_serializer::serialized_base
+    namespace impl
+    {
+        // traces a call of a container function and its items, see trace_writer.
+        // does nothing when the serializer has no trace_writer, or is a basic_serializer.
+        class container_trace
+        {
+        public:
+            template<typename TSERIALIZER>
+            container_trace(TSERIALIZER& ser, const char* _item_name)
+            : _item_name(_item_name)
+            {
+                if constexpr (std::is_base_of_v<serializer_base, TSERIALIZER>)
+                    _tracer = ser.get_tracer();
+                if (nullptr != _tracer) [[unlikely]]
+                    _start_us = _tracer->now_us();
+            }
+
+            ~container_trace()
+            {
+                if (nullptr != _tracer) [[unlikely]]
+                    _tracer->end_container(_item_name, _start_us, _num_items);
+            }
+
+            container_trace(const container_trace&) = delete;
+            container_trace& operator=(const container_trace&) = delete;
+
+            int64_t item_begin() const { return nullptr != _tracer ? _tracer->now_us() : 0; }
+
+            void item_end(const char* _name, const int64_t _item_start_us)
+            {
+                if (nullptr != _tracer) [[unlikely]]
+                    _tracer->end_item(_name, _item_start_us, _num_items);
+                ++_num_items;
+            }
+
+            // same as item_end for the tasks of serialize_container_parallel, thread safe: the items are counted with add_items
+            void item_end(const char* _name, const int64_t _item_start_us, const size_t _index) const
+            {
+                if (nullptr != _tracer) [[unlikely]]
+                    _tracer->end_item(_name, _item_start_us, _index);
+            }
+
+            void add_items(const size_t _count) { _num_items += _count; }
+
+        private:
+            trace_writer* _tracer = nullptr;
+            const char* _item_name;
+            int64_t _start_us = 0;
+            size_t _num_items = 0;
+        };
+    }
+
     // write: iterate in_container, create element named container_item_name for for each and call T_ITEM.serialize on new element
     // read: iterate on all elements named container_item_name and serialize each into a new T_ITEM, but no more than array_end-array_begin times
-    template<typename TCONTAINER>
-    void serialize_container(pugi_serializer::serializer_base& ser, TCONTAINER& in_container, const char* container_item_name)
+    template<typename TSERIALIZER, typename TCONTAINER>
+    void serialize_container(TSERIALIZER& ser, TCONTAINER& in_container, const name_token& container_item_name)
     {
+        impl::container_trace trace(ser, container_item_name.c_str());
         if (ser.reading())
         {
+            impl::items_not_moved<TCONTAINER> check(ser, in_container);
+            impl::reserve_if_possible(in_container, impl::count_items(ser, container_item_name));
+            check.reserved();
+            std::pmr::memory_resource* resource = impl::memory_resource_of(ser);
             for (auto item_ser = ser.child(container_item_name); item_ser; item_ser = item_ser.next_sibling(container_item_name))
             {
-                typename TCONTAINER::value_type& new_value = in_container.emplace_back();
+                const int64_t item_start_us = trace.item_begin();
+                typename TCONTAINER::value_type& new_value = impl::emplace_item(in_container, resource);
                 new_value.serialize(item_ser);
+                trace.item_end(container_item_name.c_str(), item_start_us);
             }
         }
         else if (ser.writing())
         {
             for (auto& item : in_container)
             {
+                const int64_t item_start_us = trace.item_begin();
                 auto item_ser = ser.child(container_item_name);
                 item.serialize(item_ser);
+                trace.item_end(container_item_name.c_str(), item_start_us);
             }
         }
     }
+
+    // same as serialize_container, but when the serializer has a thread pool, see reader::set_thread_pool, writer::set_thread_pool,
+    // the items are serialized in parallel:
+    // read: the container is resized to the number of items, and groups of items are read
+    //       by tasks on the pool's threads, each with its own task_reader.
+    // write: groups of items are written by tasks on the pool's threads, each to its own fragment_writer,
+    //        and the fragments are then appended in order. The output is the same as with serialize_container.
+    // Items may call serialize_container_parallel for their own containers, which are then split into more tasks.
+    // TCONTAINER should be resizable and have operator[], e.g. std::vector, otherwise items are serialized with serialize_container.
+    template<typename TSERIALIZER, typename TCONTAINER>
+    void serialize_container_parallel(TSERIALIZER& ser, TCONTAINER& in_container, const name_token& container_item_name)
+    {
+        if constexpr (std::is_base_of_v<serializer_base, TSERIALIZER> && requires { in_container.resize(0); in_container[0]; })
+        {
+            thread_pool* pool = ser.get_thread_pool();
+            if (nullptr != pool && ser.reading() && ser.has_document_nodes())
+            {
+                impl::container_trace trace(ser, container_item_name.c_str());
+                std::vector<pugi::xml_node> item_nodes;
+                for (auto node = impl::find_child(ser.curr_node(), container_item_name); node; node = impl::find_next_sibling(node, container_item_name))
+                    item_nodes.push_back(node);
+
+                const size_t first_new_item = in_container.size();
+                impl::items_not_moved<TCONTAINER> check(ser, in_container);
+                if (std::pmr::memory_resource* resource = ser.get_memory_resource(); nullptr != resource)
+                {
+                    impl::reserve_if_possible(in_container, item_nodes.size());
+                    for (size_t i = 0; i < item_nodes.size(); ++i)
+                        impl::emplace_item(in_container, resource);
+                }
+                else
+                    in_container.resize(first_new_item + item_nodes.size());
+                check.reserved();
+
+                // a few groups per thread, so threads that finish early can take groups from others
+                const size_t num_groups = std::max<size_t>(1, std::min<size_t>(item_nodes.size(), size_t(pool->size()) * 4));
+                pool->parallel_for(num_groups, [&](const size_t group)
+                {
+                    task_reader item_reader(ser);
+                    const size_t group_end = item_nodes.size() * (group + 1) / num_groups;
+                    for (size_t i = item_nodes.size() * group / num_groups; i < group_end; ++i)
+                    {
+                        const int64_t item_start_us = trace.item_begin();
+                        item_reader.set_node(item_nodes[i]);
+                        in_container[first_new_item + i].serialize(static_cast<serializer_base&>(item_reader));
+                        trace.item_end(container_item_name.c_str(), item_start_us, i);
+                    }
+                });
+                trace.add_items(item_nodes.size());
+                return;
+            }
+            else if (ser.writing() && nullptr != pool && in_container.size() > 1)
+            {
+                impl::container_trace trace(ser, container_item_name.c_str());
+                const size_t num_items = in_container.size();
+                const size_t num_groups = std::min<size_t>(num_items, size_t(pool->size()) * 4);
+
+                // fragments are created in order on this thread, since creating one may write to the parent's output
+                std::vector<std::unique_ptr<fragment_writer>> fragments;
+                fragments.reserve(num_groups);
+                for (size_t group = 0; group < num_groups; ++group)
+                    fragments.push_back(std::make_unique<fragment_writer>(ser));
+
+                pool->parallel_for(num_groups, [&](const size_t group)
+                {
+                    const size_t group_end = num_items * (group + 1) / num_groups;
+                    for (size_t i = num_items * group / num_groups; i < group_end; ++i)
+                    {
+                        const int64_t item_start_us = trace.item_begin();
+                        auto item_ser = fragments[group]->child(container_item_name);
+                        in_container[i].serialize(item_ser);
+                        trace.item_end(container_item_name.c_str(), item_start_us, i);
+                    }
+                });
+
+                for (auto& fragment : fragments)
+                    fragment->append_to_parent();
+                trace.add_items(num_items);
+                return;
+            }
+        }
+        serialize_container(ser, in_container, container_item_name);
+    }
+
+    // read the children named container_item_name one at a time into a TITEM, and call _func(TITEM&) for each,
+    // instead of appending them to a container. return the number of items read.
+    // nothing is done when writing.
+    template<typename TITEM, typename TSERIALIZER, typename TFunc>
+    size_t serialize_each(TSERIALIZER& ser, const name_token& container_item_name, TFunc&& _func)
+    {
+        size_t num_items = 0;
+        if (ser.reading())
+        {
+            std::pmr::memory_resource* resource = impl::memory_resource_of(ser);
+            for (auto item_ser = ser.child(container_item_name); item_ser; item_ser = item_ser.next_sibling(container_item_name))
+            {
+                TITEM item = impl::make_item<TITEM>(resource);
+                item.serialize(item_ser);
+                _func(item);
+                ++num_items;
+            }
+        }
+        return num_items;
+    }
+
+    // same as above for the children of a stream_reader's root, only one item is in memory at a time.
+    // children with other names are skipped.
+    template<typename TITEM, typename TFunc>
+    size_t serialize_each(stream_reader& _reader, const name_token& container_item_name, TFunc&& _func)
+    {
+        size_t num_items = 0;
+        for (pugi::xml_node item = _reader.next_item(); item; item = _reader.next_item())
+        {
+            if (container_item_name.matches(item.name()))
+            {
+                reader item_reader(item);
+                TITEM new_item;
+                new_item.serialize(static_cast<serializer_base&>(item_reader));
+                _func(new_item);
+                ++num_items;
+            }
+        }
+        return num_items;
+    }
+
+    // a container and the name of the elements of its items, see serialize_containers
+    template<typename TCONTAINER>
+    struct container_binding
+    {
+        TCONTAINER& container;
+        name_token item_name;
+    };
+
+    template<typename TCONTAINER>
+    container_binding<TCONTAINER> bind_container(TCONTAINER& in_container, const name_token& container_item_name)
+    {
+        return container_binding<TCONTAINER>{in_container, container_item_name};
+    }
+
+    // serialize several containers whose items are siblings under the same parent
+    // same result as calling serialize_container for each binding in order, but:
+    // read: walk the parent's children once to count the items of each container and reserve,
+    //       then once more to serialize each child into the container bound to its name.
+    //       Children whose name is not bound are skipped.
+    // write: write each container in the order the bindings were given
+    template<typename TSERIALIZER, typename... TCONTAINERS>
+    void serialize_containers(TSERIALIZER& ser, container_binding<TCONTAINERS>... bindings)
+    {
+        constexpr size_t num_bindings = sizeof...(TCONTAINERS);
+        auto bindings_tuple = std::forward_as_tuple(bindings...);
+        if (ser.reading())
+        {
+            impl::container_trace trace(ser, "serialize_containers");
+            std::pmr::memory_resource* resource = impl::memory_resource_of(ser);
+            const name_token item_names[num_bindings] = {bindings.item_name...};
+            size_t item_counts[num_bindings] = {};
+            for (auto item_ser = ser.first_child(); item_ser; item_ser = item_ser.next_sibling())
+            {
+                size_t binding_index = impl::find_item_name(item_names, num_bindings, item_ser.node_name());
+                if (binding_index < num_bindings)
+                    ++item_counts[binding_index];
+            }
+
+            std::tuple<impl::items_not_moved<TCONTAINERS>...> checks(impl::items_not_moved<TCONTAINERS>(ser, bindings.container)...);
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                (impl::reserve_if_possible(std::get<I>(bindings_tuple).container, item_counts[I]), ...);
+                (std::get<I>(checks).reserved(), ...);
+            }(std::make_index_sequence<num_bindings>{});
+
+            for (auto item_ser = ser.first_child(); item_ser; item_ser = item_ser.next_sibling())
+            {
+                size_t binding_index = impl::find_item_name(item_names, num_bindings, item_ser.node_name());
+                if (binding_index >= num_bindings)
+                    continue;
+                const int64_t item_start_us = trace.item_begin();
+                [&]<size_t... I>(std::index_sequence<I...>)
+                {
+                    ((binding_index == I ? (void)impl::emplace_item(std::get<I>(bindings_tuple).container, resource).serialize(item_ser) : (void)0), ...);
+                }(std::make_index_sequence<num_bindings>{});
+                trace.item_end(item_names[binding_index].c_str(), item_start_us);
+            }
+        }
+        else if (ser.writing())
+        {
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                (serialize_container(ser, std::get<I>(bindings_tuple).container, std::get<I>(bindings_tuple).item_name), ...);
+            }(std::make_index_sequence<num_bindings>{});
+        }
+    }
+
+    namespace impl
+    {
+        // key and value types of a keyed container: std::map, std::unordered_map or std::vector<std::pair<key, value>>
+        template<typename TCONTAINER>
+        struct keyed_container_traits
+        {
+            using key_type = std::remove_const_t<typename TCONTAINER::value_type::first_type>;
+            using mapped_type = typename TCONTAINER::value_type::second_type;
+        };
+
+        struct key_less
+        {
+            template<typename TITEM>
+            bool operator()(const TITEM& _left, const TITEM& _right) const { return _left.first < _right.first; }
+        };
+    }
+
+    // serialize a keyed container: std::map, std::unordered_map, or a flat std::vector<std::pair<key, value>> sorted by key.
+    // each item is an element named container_item_name, and its key is the element's attribute key_attrib_name, e.g. "car_code".
+    // read: the items are counted first, so storage is allocated once.
+    //       The key is read from key_attrib_name, and the value is read by its serialize function.
+    //       When a key appears more than once, the first item is kept, same as std::map::try_emplace.
+    //       std::unordered_map: reserved, and items are read directly into the map.
+    //       std::map: items are read into a vector, sorted, and inserted in order at the end of the map.
+    //       flat vector: items are appended, and the vector is sorted and made unique once, see find_keyed().
+    // write: the values are written in the container's order. The key is not written separately,
+    //        the value's serialize function should write key_attrib_name itself.
+    template<typename TSERIALIZER, typename TCONTAINER>
+    void serialize_keyed_container(TSERIALIZER& ser, TCONTAINER& in_container, const name_token& container_item_name, const name_token& key_attrib_name)
+    {
+        using key_type = typename impl::keyed_container_traits<TCONTAINER>::key_type;
+        using mapped_type = typename impl::keyed_container_traits<TCONTAINER>::mapped_type;
+
+        if (ser.reading())
+        {
+            const size_t num_items = impl::count_items(ser, container_item_name);
+            if constexpr (requires { in_container.emplace_back(); })  // flat vector
+            {
+                in_container.reserve(in_container.size() + num_items);
+                for (auto item_ser = ser.child(container_item_name); item_ser; item_ser = item_ser.next_sibling(container_item_name))
+                {
+                    auto& new_item = in_container.emplace_back();
+                    item_ser.attribute(key_attrib_name, new_item.first);
+                    new_item.second.serialize(item_ser);
+                }
+                std::stable_sort(in_container.begin(), in_container.end(), impl::key_less());
+                auto duplicates = std::unique(in_container.begin(), in_container.end(),
+                                              [](const auto& _left, const auto& _right) { return !(_left.first < _right.first) && !(_right.first < _left.first); });
+                in_container.erase(duplicates, in_container.end());
+            }
+            else if constexpr (requires { in_container.bucket_count(); })  // hashed map
+            {
+                in_container.reserve(in_container.size() + num_items);
+                for (auto item_ser = ser.child(container_item_name); item_ser; item_ser = item_ser.next_sibling(container_item_name))
+                {
+                    key_type key{};
+                    item_ser.attribute(key_attrib_name, key);
+                    auto [item, inserted] = in_container.try_emplace(std::move(key));
+                    if (inserted)
+                        item->second.serialize(item_ser);
+                }
+            }
+            else  // ordered map
+            {
+                std::vector<std::pair<key_type, mapped_type>> new_items;
+                new_items.reserve(num_items);
+                for (auto item_ser = ser.child(container_item_name); item_ser; item_ser = item_ser.next_sibling(container_item_name))
+                {
+                    auto& new_item = new_items.emplace_back();
+                    item_ser.attribute(key_attrib_name, new_item.first);
+                    new_item.second.serialize(item_ser);
+                }
+                std::stable_sort(new_items.begin(), new_items.end(), impl::key_less());
+                for (auto& new_item : new_items)
+                    in_container.emplace_hint(in_container.end(), std::move(new_item.first), std::move(new_item.second));
+            }
+        }
+        else if (ser.writing())
+        {
+            for (auto& item : in_container)
+            {
+                auto item_ser = ser.child(container_item_name);
+                item.second.serialize(item_ser);
+            }
+        }
+    }
+
+    // find _key in a flat keyed container sorted by serialize_keyed_container, with a binary search.
+    // return a pointer to the key's value, or nullptr if not found.
+    template<typename TCONTAINER, typename TKEY>
+    auto find_keyed(TCONTAINER& in_container, const TKEY& _key) -> decltype(&in_container.begin()->second)
+    {
+        auto found = std::lower_bound(in_container.begin(), in_container.end(), _key,
+                                      [](const auto& _item, const TKEY& _a_key) { return _item.first < _a_key; });
+        if (found != in_container.end() && !(_key < found->first))
+            return &found->second;
+        return nullptr;
+    }
 }
 
 
@@ -4,18 +4,13 @@
 #include <string_view>
 #include <compare>
 #include <filesystem>
+#include <sstream>
+#include <fstream>
 
 #include "gtest/gtest.h"
 #include "pugi_serializer.hpp"
-
-auto operator<=>(const std::string& lhs, const std::string& rhs)
-{
-    // apple clang 21.6.0: no support for std::string::operator<=> (8-<)
-    int comp_res = lhs.compare(rhs);
-    if (0 > comp_res) return std::strong_ordering::less;
-    else if (0 < comp_res) return std::strong_ordering::greater;
-    else return std::strong_ordering::equal;
-}
+#include "mondial_model.hpp"
+#include "mondial_generator.hpp"
 
 static void banana()
 {
@@ -31,390 +26,6 @@ static void banana()
     }
 }
 
-class encompassed : public pugi_serializer::serialized_base
-{
-public:
-    friend auto operator<=>(const encompassed&, const encompassed&) = default;
-    friend bool operator==(const encompassed&, const encompassed&) = default;
-
-    std::string continent;
-    float percentage;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        ser.attribute("continent", continent);
-        ser.attribute("percentage", percentage);
-    }
-};
-
-class border : public pugi_serializer::serialized_base
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const border&, const border&) = default;
-#endif
-    std::string country;
-    float length;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        ser.attribute("country", country);
-        ser.attribute("length", length);
-    }
-};
-
-// entity has an is and a name
-class entity : public pugi_serializer::serialized_base
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const entity&, const entity&) = default;
-#endif
-
-    std::string id;
-    std::string name;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        ser.attribute("id", id);
-        ser.attribute("name", name, "");
-    }
-};
-
-class coordinates : public pugi_serializer::serialized_base
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const coordinates&, const coordinates&) = default;
-#endif
-    float longitude = 0.0;
-    float latitude = 0.0;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        ser.attribute("longitude", longitude);
-        ser.attribute("latitude", latitude);
-    }
-
-};
-
-class continent : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const continent&, const continent&) = default;
-#endif
-};
-
-class percentage_value : public pugi_serializer::serialized_base
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const percentage_value&, const percentage_value&) = default;
-#endif
-    std::string name;
-    float percentage = 0.0;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        ser.attribute("percentage", percentage);
-        ser.text(name);
-    }
-};
-
-class city : public entity, coordinates
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const city&, const city&) = default;
-#endif
-    std::string country;
-    int population_year = 0;
-    unsigned int population = 0;
-
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        // city has it's name as element text, not as attribute so cannot call
-        //entity::serialize(ser);
-        
-        ser.attribute("id", id);
-        ser.child_with_text("name", name, "");
-
-        ser.attribute("country", country);
-        
-        coordinates::serialize(ser);
-        
-        auto population_ser = ser.child_with_text("population", population, (unsigned int)0);
-        // note that when wrtting and set_should_write_default_values(false),
-        // attrib "year" will only be written if population!=0
-        population_ser.attribute("year", population_year);
-    }
-};
-
-class province : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const province&, const province&) = default;
-#endif
-    std::string country;
-    std::string capital;
-    unsigned int population = 0;
-    unsigned int area = 0;
-    std::vector<city> cities_vec;
-
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        ser.attribute("country", country);
-        ser.attribute("capital", capital);
-        ser.attribute("population", population);
-        ser.attribute("area", area);
-
-        pugi_serializer::serialize_container(ser, cities_vec, "city");
-
-    }
-};
-
-class country : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const country&, const country&) = default;
-#endif
-    std::string name_text;
-    std::string capital;
-    int population = 0;
-    std::string datacode;
-    int total_area = 0;
-    double population_growth = 0.0;
-    double infant_mortality = 0.0;
-    double gdp_agri = 0.0;
-    int gdp_total = 0;
-    float inflation = 0.0;
-    std::string indep_date;
-    std::string government;
-    std::string car_code;
-    
-    std::vector<city>             cities_vec;
-    std::vector<province>         provinces_vec;
-    std::vector<percentage_value> ethnicgroups_vec;
-    std::vector<percentage_value> religions_vec;
-    std::vector<percentage_value> languages_vec;
-    std::vector<encompassed>      encompassed_vec;
-    std::vector<border>           borders_vec;
-
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        ser.attribute("capital", capital);
-        ser.attribute("population", population);
-        ser.attribute("total_area", total_area);
-        ser.attribute("population_growth", population_growth);
-        ser.attribute("infant_mortality", infant_mortality);
-        ser.attribute("gdp_agri", gdp_agri);
-        ser.attribute("gdp_total", gdp_total);
-        ser.attribute("inflation", inflation, 0.0f);
-        ser.attribute("population", population);
-        ser.attribute("indep_date", indep_date, "");
-        ser.attribute("government", government);
-        ser.attribute("car_code", car_code);
-        
-        ser.child("name").text(name_text);
-
-        pugi_serializer::serialize_container(ser, cities_vec, "city");
-        pugi_serializer::serialize_container(ser, provinces_vec, "province");
-        pugi_serializer::serialize_container(ser, ethnicgroups_vec, "ethnicgroups");
-        pugi_serializer::serialize_container(ser, religions_vec, "religions");
-        pugi_serializer::serialize_container(ser, languages_vec, "languages");
-        pugi_serializer::serialize_container(ser, encompassed_vec, "encompassed");
-        pugi_serializer::serialize_container(ser, borders_vec, "border");
-    }
-};
-
-class organization : entity
-{
-public:
-    friend auto operator<=>(const organization&, const organization&) = default;
-
-    std::string abbrev;
-    std::string established;
-    std::string headq;
-    
-    class member : public pugi_serializer::serialized_base
-    {
-    public:
-        std::string type;
-        std::string country;
-        void serialize(pugi_serializer::serializer_base& ser) override
-        {
-            ser.attribute("type", type);
-            ser.attribute("country", country);
-        }
-    };
-    std::vector<member> members_vec;
-    
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        ser.attribute("abbrev", abbrev);
-        ser.attribute("established", established, "");
-        ser.attribute("headq", headq, "");
-
-        pugi_serializer::serialize_container(ser, members_vec, "members");
-    }
-};
-
-class located : public pugi_serializer::serialized_base
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const located&, const located&) = default;
-#endif
-    //std::vector<std::pair<std::string, std::string>> locations;
-    std::string country;
-    std::string province;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        ser.attribute("country", country);
-        ser.attribute("province", province);
-    }
-};
-
-class feature : public entity, coordinates
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const feature&, const feature&) = default;
-#endif
-    std::vector<located> locations_vec;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        coordinates::serialize(ser);
-        pugi_serializer::serialize_container(ser, locations_vec, "located");
-    }
-};
-
-class mountain : public feature
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const mountain&, const mountain&) = default;
-#endif
-    uint64_t height = 0;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        feature::serialize(ser);
-        ser.attribute("height", height);
-    }
-};
-
-class desert : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const desert&, const desert&) = default;
-#endif
-    uint64_t area = 0;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        ser.attribute("area", area);
-    }
-};
-
-class river : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const river&, const river&) = default;
-#endif
-    std::string to_type;
-    std::string to_water;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        
-        auto to_node = ser.child("to");
-        to_node.attribute("type", to_type);
-        to_node.attribute("water", to_water);
-    }
-};
-
-class island : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const island&, const island&) = default;
-#endif
-    uint64_t area = 0;
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        ser.attribute("area", area);
-    }
-};
-
-class sea : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const sea&, const sea&) = default;
-#endif
-    uint64_t depth = 0;
-    std::vector<located> locations_vec;
-
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        ser.attribute("depth", depth);
-        pugi_serializer::serialize_container(ser, locations_vec, "located");
-    }
-};
-
-class lake : public entity
-{
-public:
-#if (__cplusplus == 202002L)  // c++20
-    friend auto operator<=>(const lake&, const lake&) = default;
-#endif
-    float area = 0.0f;
-    std::vector<located> locations_vec;
-
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        entity::serialize(ser);
-        ser.attribute("area", area, 0.0f);
-        pugi_serializer::serialize_container(ser, locations_vec, "located");
-    }
-};
-
-class world : public pugi_serializer::serialized_base
-{
-public:
-    friend auto operator<=>(const world&, const world&) = default;
-
-    std::vector<continent> continent_vec;
-    std::vector<country> country_vec;
-    std::vector<organization> organization_vec;
-    std::vector<mountain> mountain_vec;
-    std::vector<desert> desert_vec;
-    std::vector<island> island_vec;
-    std::vector<river> river_vec;
-    std::vector<sea> sea_vec;
-    std::vector<lake> lake_vec;
-    
-
-    void serialize(pugi_serializer::serializer_base& ser) override
-    {
-        pugi_serializer::serialize_container(ser, continent_vec, "continent");
-        pugi_serializer::serialize_container(ser, country_vec, "country");
-        pugi_serializer::serialize_container(ser, organization_vec, "organization");
-        pugi_serializer::serialize_container(ser, mountain_vec, "mountain");
-        pugi_serializer::serialize_container(ser, desert_vec, "desert");
-        pugi_serializer::serialize_container(ser, island_vec, "island");
-        pugi_serializer::serialize_container(ser, river_vec, "river");
-        pugi_serializer::serialize_container(ser, sea_vec, "sea");
-        pugi_serializer::serialize_container(ser, lake_vec, "lake");
-    }
-};
-
 const char* big_file_name = "tests/mondial-3.0.xml";
 const char* big_file_out_name = "tests/mondial-3.0.out.xml";
 const char* big_file_ref_name = "tests/mondial-3.0.ref.xml";
@@ -428,9 +39,14 @@ TEST(TestBigFile, read)
     EXPECT_STREQ(doc.document_element().name(), "mondial") << "document_element is named " << doc.document_element().name() << " instead of " << "'mondial'";
 
     pugi_serializer::reader reader_serializer(doc);
+    reader_serializer.set_should_use_ordered_lookup(true);
     world w;
     w.serialize(reader_serializer);
     
+    // mondial fields are read mostly in document order
+    pugi_serializer::lookup_stats stats = reader_serializer.get_lookup_stats();
+    EXPECT_GT(stats.cursor_hits, stats.cursor_misses);
+
     EXPECT_EQ(w.continent_vec.size(), 5) << "expected 5 continents";
     EXPECT_EQ(w.continent_vec.front().id, "f0_119") << "expected 1st continent id to be f0_119";
     EXPECT_EQ(w.continent_vec.front().name, "Europe") << "expected 1st continent name to be Europe";
@@ -500,3 +116,447 @@ TEST(TestBigFile, write)
 
     ASSERT_EQ(w_1, w_2);
 }
+
+TEST(TestBigFile, static_same_as_runtime)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+
+    pugi_serializer::reader reader_serializer(read_doc);
+    world runtime_world;
+    runtime_world.serialize(reader_serializer);
+    pugi_serializer::static_reader static_reader_serializer(read_doc);
+    world static_world;
+    static_world.serialize(static_reader_serializer);
+    EXPECT_EQ(runtime_world, static_world);
+
+    // from_chars reads the same values as pugixml
+    pugi_serializer::reader from_chars_reader(read_doc);
+    from_chars_reader.set_should_use_from_chars(true);
+    world from_chars_world;
+    from_chars_world.serialize(from_chars_reader);
+    EXPECT_EQ(runtime_world, from_chars_world);
+
+    pugi::xml_document runtime_doc;
+    {
+        pugi_serializer::writer writer_serializer(runtime_doc, "mondial");
+        writer_serializer.set_should_write_default_values(false);
+        runtime_world.serialize(writer_serializer);
+    }
+    pugi::xml_document static_doc;
+    {
+        pugi_serializer::static_writer writer_serializer(static_doc, "mondial");
+        writer_serializer.set_should_write_default_values(false);
+        runtime_world.serialize(writer_serializer);
+    }
+    std::ostringstream runtime_out, static_out;
+    runtime_doc.save(runtime_out);
+    static_doc.save(static_out);
+    EXPECT_EQ(runtime_out.str(), static_out.str());
+}
+
+TEST(TestBigFile, write_to_chars_round_trip)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc_1;
+    pugi::xml_parse_result pugi_parse_result = read_doc_1.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+
+    pugi_serializer::reader reader_serializer_1(read_doc_1);
+    world w_1;
+    w_1.serialize(reader_serializer_1);
+
+    // write, read back and write again, with shortest round trip numbers both writes should be identical
+    auto write_to_string = [](world& _w)
+    {
+        pugi::xml_document write_doc;
+        pugi_serializer::writer writer_serializer(write_doc, "mondial");
+        writer_serializer.set_should_write_default_values(false);
+        writer_serializer.set_should_use_to_chars(true);
+        _w.serialize(writer_serializer);
+        std::ostringstream oss;
+        write_doc.save(oss);
+        return oss.str();
+    };
+
+    std::string written_1 = write_to_string(w_1);
+
+    pugi::xml_document read_doc_2;
+    pugi_parse_result = read_doc_2.load_string(written_1.c_str(), pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status);
+    pugi_serializer::reader reader_serializer_2(read_doc_2);
+    world w_2;
+    w_2.serialize(reader_serializer_2);
+    ASSERT_EQ(w_1, w_2);
+
+    std::string written_2 = write_to_string(w_2);
+    EXPECT_EQ(written_1, written_2);
+}
+
+TEST(TestBigFile, stream_writer_same_as_dom)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+
+    pugi_serializer::reader reader_serializer(read_doc);
+    world w;
+    w.serialize(reader_serializer);
+
+    pugi::xml_document write_doc;
+    pugi_serializer::writer writer_serializer(write_doc, "mondial");
+    writer_serializer.set_should_write_default_values(false);
+    w.serialize(writer_serializer);
+    std::ostringstream dom_out;
+    write_doc.save(dom_out);
+
+    std::string stream_out;
+    {
+        pugi_serializer::stream_writer stream_serializer(stream_out, "mondial");
+        stream_serializer.set_should_write_default_values(false);
+        w.serialize(stream_serializer);
+        stream_serializer.finish();
+        EXPECT_EQ(0u, stream_serializer.get_out_of_order_count());
+    }
+
+    EXPECT_EQ(dom_out.str(), stream_out);
+}
+
+TEST(TestBigFile, stream_reader_countries)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::reader reader_serializer(read_doc);
+    world w;
+    w.serialize(reader_serializer);
+
+    // read the countries one at a time, without loading the whole file
+    std::ifstream in_file(big_file_name, std::ios::binary);
+    ASSERT_TRUE(in_file.good()) << "failed to open " << big_file_name;
+    pugi_serializer::stream_reader sr(in_file, pugi_parse_options);
+    std::vector<country> countries;
+    pugi_serializer::serialize_each<country>(sr, "country", [&](country& _country) { countries.push_back(_country); });
+
+    EXPECT_EQ(pugi::status_ok, sr.status());
+    EXPECT_EQ(w.country_vec, countries);
+}
+
+TEST(TestBigFile, read_mapped_file)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::reader reader_serializer(read_doc);
+    world w_1;
+    w_1.serialize(reader_serializer);
+
+    world w_2;
+    {
+        pugi_serializer::reader mapped_reader(pugi_serializer::load_mapped_file(big_file_name, pugi_parse_options, pugi_serializer::map_hint_sequential, &pugi_parse_result));
+        ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to map " << big_file_name;
+        w_2.serialize(mapped_reader);
+    }
+
+    EXPECT_EQ(w_1, w_2);
+
+    // the file itself should not be changed by parsing in place
+    pugi::xml_document reread_doc;
+    ASSERT_EQ(pugi::status_ok, reread_doc.load_file(big_file_name, pugi_parse_options).status);
+    pugi_serializer::reader reread_serializer(reread_doc);
+    world w_3;
+    w_3.serialize(reread_serializer);
+    EXPECT_EQ(w_1, w_3);
+}
+
+TEST(TestBigFile, read_parallel)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::reader reader_serializer(read_doc);
+    reader_serializer.set_should_use_from_chars(true);
+    world w;
+    w.serialize(reader_serializer);
+
+    // countries are split between the threads, and each province's cities are split again
+    pugi_serializer::thread_pool pool(4);
+    pugi_serializer::reader parallel_reader(read_doc);
+    parallel_reader.set_should_use_from_chars(true);
+    parallel_reader.set_thread_pool(&pool);
+    std::vector<country> countries;
+    pugi_serializer::serialize_container_parallel(parallel_reader, countries, "country");
+
+    EXPECT_EQ(w.country_vec, countries);
+    EXPECT_EQ(reader_serializer.get_parse_errors().size(), parallel_reader.get_parse_errors().size());
+}
+
+TEST(TestBigFile, read_with_plans)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::reader reader_serializer(read_doc);
+    world w_1;
+    w_1.serialize(reader_serializer);
+
+    pugi_serializer::reader plan_reader(read_doc);
+    plan_reader.set_should_use_plans(true);
+    world w_2;
+    w_2.serialize(plan_reader);
+    EXPECT_EQ(w_1, w_2);
+
+    // mondial items of the same kind mostly have the same attributes and children
+    pugi_serializer::plan_stats stats = plan_reader.get_plan_stats();
+    EXPECT_GT(stats.hits, stats.misses);
+    EXPECT_GT(stats.plans_recorded, 0u);
+}
+
+TEST(TestBigFile, trace)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    std::ostringstream trace_stream;
+    pugi_serializer::trace_writer tracer(trace_stream, 0.0);
+    pugi::xml_document read_doc;
+    {
+        pugi_serializer::trace_span span(&tracer, "load_file");
+        pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+        ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    }
+    pugi_serializer::reader reader_serializer(read_doc);
+    reader_serializer.set_tracer(&tracer);
+    world w;
+    w.serialize(reader_serializer);
+
+    // items read by the tasks of serialize_container_parallel have their spans too
+    pugi_serializer::thread_pool pool(4);
+    pugi_serializer::reader parallel_reader(read_doc);
+    parallel_reader.set_tracer(&tracer);
+    parallel_reader.set_thread_pool(&pool);
+    std::vector<country> countries;
+    pugi_serializer::serialize_container_parallel(parallel_reader, countries, "country");
+    tracer.finish();
+
+    const std::string trace = trace_stream.str();
+    const std::string country_item = "{\"name\":\"country\",\"cat\":\"item\"";
+    size_t num_country_items = 0;
+    for (size_t pos = trace.find(country_item); std::string::npos != pos; pos = trace.find(country_item, pos + 1))
+        ++num_country_items;
+    EXPECT_EQ(num_country_items, 2 * w.country_vec.size());
+    EXPECT_EQ(size_t{0}, trace.find("{\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, trace.find("{\"name\":\"load_file\",\"cat\":\"pugi_serializer\""));
+    EXPECT_NE(std::string::npos, trace.find("{\"name\":\"country\",\"cat\":\"serialize_container\""));
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"count\":" + std::to_string(w.country_vec.size()) + "}"));
+    EXPECT_NE(std::string::npos, trace.find("{\"name\":\"country\",\"cat\":\"item\""));
+    EXPECT_EQ(trace.size() - 4, trace.rfind("\n]}\n"));
+}
+
+TEST(TestBigFile, write_parallel)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::reader reader_serializer(read_doc);
+    world w;
+    w.serialize(reader_serializer);
+
+    pugi::xml_document sequential_doc;
+    {
+        pugi_serializer::writer writer_serializer(sequential_doc, "mondial");
+        pugi_serializer::serialize_container(writer_serializer, w.country_vec, "country");
+    }
+    std::ostringstream sequential_out;
+    sequential_doc.save(sequential_out);
+
+    // countries are split between the threads, and each province's cities are split again
+    pugi_serializer::thread_pool pool(4);
+
+    pugi::xml_document parallel_doc;
+    {
+        pugi_serializer::writer writer_serializer(parallel_doc, "mondial");
+        writer_serializer.set_thread_pool(&pool);
+        pugi_serializer::serialize_container_parallel(writer_serializer, w.country_vec, "country");
+    }
+    std::ostringstream parallel_out;
+    parallel_doc.save(parallel_out);
+    EXPECT_EQ(sequential_out.str(), parallel_out.str());
+
+    std::string stream_out;
+    {
+        pugi_serializer::stream_writer writer_serializer(stream_out, "mondial");
+        writer_serializer.set_thread_pool(&pool);
+        pugi_serializer::serialize_container_parallel(writer_serializer, w.country_vec, "country");
+        writer_serializer.finish();
+        EXPECT_EQ(0u, writer_serializer.get_out_of_order_count());
+    }
+    EXPECT_EQ(sequential_out.str(), stream_out);
+}
+
+TEST(TestBigFile, binary_round_trip)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::reader reader_serializer(read_doc);
+    world w_1;
+    w_1.serialize(reader_serializer);
+
+    std::string encoded;
+    {
+        pugi_serializer::binary_writer writer_serializer(encoded, "mondial");
+        writer_serializer.set_should_write_default_values(false);
+        w_1.serialize(writer_serializer);
+    }
+
+    pugi_serializer::binary_reader binary_serializer(encoded);
+    ASSERT_EQ(pugi::status_ok, binary_serializer.status());
+    world w_2;
+    w_2.serialize(binary_serializer);
+    EXPECT_EQ(w_1, w_2);
+}
+
+TEST(TestBigFile, lazy_countries)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    auto read_doc = std::make_shared<pugi::xml_document>();
+    pugi::xml_parse_result pugi_parse_result = read_doc->load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::reader reader_serializer(read_doc);
+    std::vector<country> countries;
+    pugi_serializer::serialize_container(reader_serializer, countries, "country");
+
+    std::vector<pugi_serializer::lazy<country>> lazy_countries;
+    pugi_serializer::serialize_container(reader_serializer, lazy_countries, "country");
+    ASSERT_EQ(lazy_countries.size(), countries.size());
+    EXPECT_FALSE(lazy_countries[100].is_loaded());
+    EXPECT_EQ(lazy_countries[100].get(), countries[100]);
+    EXPECT_TRUE(lazy_countries[100].is_loaded());
+    EXPECT_FALSE(lazy_countries[101].is_loaded()) << "only the country that was used should be read";
+
+    // countries that were not read are copied from their element, and read back the same
+    pugi::xml_document write_doc;
+    {
+        pugi_serializer::writer writer_serializer(write_doc, "mondial");
+        pugi_serializer::serialize_container(writer_serializer, lazy_countries, "country");
+    }
+    pugi_serializer::reader written_reader(write_doc);
+    std::vector<country> written_countries;
+    pugi_serializer::serialize_container(written_reader, written_countries, "country");
+    EXPECT_EQ(written_countries, countries);
+    EXPECT_FALSE(lazy_countries[101].is_loaded());
+
+    // static serializers have no settings to share: countries are read right away, and read before they are written
+    pugi::xml_document static_doc;
+    {
+        pugi_serializer::static_writer static_writer_serializer(static_doc, "mondial");
+        pugi_serializer::serialize_container(static_writer_serializer, lazy_countries, "country");
+    }
+    EXPECT_TRUE(lazy_countries[101].is_loaded());
+    pugi_serializer::static_reader static_reader_serializer(static_doc);
+    std::vector<pugi_serializer::lazy<country>> static_countries;
+    pugi_serializer::serialize_container(static_reader_serializer, static_countries, "country");
+    ASSERT_EQ(static_countries.size(), countries.size());
+    EXPECT_TRUE(static_countries[101].is_loaded());
+    EXPECT_EQ(static_countries[101].get(), countries[101]);
+
+    // a lazy country is read with the settings of the reader it came from, even after that reader is destroyed
+    pugi_serializer::id_index index;
+    {
+        pugi_serializer::reader indexing_reader(read_doc);
+        indexing_reader.set_id_index(&index);
+        lazy_countries.clear();
+        pugi_serializer::serialize_container(indexing_reader, lazy_countries, "country");
+    }
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(lazy_countries[100].get(), countries[100]);
+    EXPECT_NE(index.find<country>(countries[100].id), nullptr);
+}
+
+TEST(TestBigFile, id_index)
+{
+    static unsigned int pugi_parse_options = pugi::parse_trim_pcdata | pugi::parse_embed_pcdata | pugi::parse_escapes | pugi::parse_cdata | pugi::parse_eol | pugi::parse_wconv_attribute;
+
+    pugi::xml_document read_doc;
+    pugi::xml_parse_result pugi_parse_result = read_doc.load_file(big_file_name, pugi_parse_options);
+    ASSERT_EQ(pugi::status_ok, pugi_parse_result.status) << "failed to read " << big_file_name;
+    pugi_serializer::id_index index;
+    pugi_serializer::reader reader_serializer(read_doc);
+    reader_serializer.set_id_index(&index);
+    world w;
+    w.serialize(reader_serializer);
+
+    // one capital and five borders refer to ids that are not in the file, and some cities are listed twice
+    EXPECT_EQ(index.resolve(), 6u);
+    EXPECT_EQ(index.size(), 3358u) << "countries and cities";
+    EXPECT_EQ(index.duplicates(), 25u);
+
+    const country& albania = w.country_vec.front();
+    ASSERT_TRUE(albania.capital);
+    EXPECT_EQ(albania.capital->name, "Tirane");
+    ASSERT_TRUE(albania.borders_vec.front().country);
+    EXPECT_EQ(albania.borders_vec.front().country->name, "Greece");
+    EXPECT_EQ(index.find<country>(albania.id), &albania);
+    EXPECT_EQ(index.find<city>(albania.id), nullptr) << "an object is found as the type it was added";
+
+    // the same objects are indexed when countries and cities are read in parallel
+    pugi_serializer::thread_pool pool(4);
+    pugi_serializer::id_index parallel_index;
+    pugi_serializer::reader parallel_reader(read_doc);
+    parallel_reader.set_thread_pool(&pool);
+    parallel_reader.set_id_index(&parallel_index);
+    std::vector<country> countries;
+    pugi_serializer::serialize_container_parallel(parallel_reader, countries, "country");
+    EXPECT_EQ(parallel_index.resolve(), 6u);
+    EXPECT_EQ(parallel_index.size(), index.size());
+    EXPECT_EQ(countries.front().capital.get(), parallel_index.find<city>("f0_1461"));
+}
+
+TEST(TestBigFile, generated_round_trip)
+{
+    generator_options options;
+    options.seed = 7;
+    options.target_bytes = 512 * 1024;
+
+    pugi::xml_document generated_doc;
+    generate_document(options, generated_doc);
+    std::ostringstream generated_out;
+    generated_doc.save(generated_out);
+    std::string generated_text = generated_out.str();
+    EXPECT_GT(generated_text.size(), options.target_bytes * 8 / 10);
+    EXPECT_LT(generated_text.size(), options.target_bytes * 13 / 10);
+
+    // same seed, same document
+    pugi::xml_document same_seed_doc;
+    generate_document(options, same_seed_doc);
+    std::ostringstream same_seed_out;
+    same_seed_doc.save(same_seed_out);
+    EXPECT_EQ(generated_text, same_seed_out.str());
+
+    pugi::xml_document read_doc;
+    ASSERT_EQ(pugi::status_ok, read_doc.load_string(generated_text.c_str()).status);
+    pugi_serializer::reader reader_serializer(read_doc);
+    world read_world;
+    read_world.serialize(reader_serializer);
+    EXPECT_EQ(generate_world(options), read_world);
+    EXPECT_GT(read_world.country_vec.size(), 10u);
+}
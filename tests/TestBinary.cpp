@@ -0,0 +1,173 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pugi_serializer.hpp"
+
+// Tests that binary_writer and binary_reader round trip values through the same serialize function
+
+class sample_values : public pugi_serializer::serialized_base
+{
+public:
+    std::string name;
+    int count = 0;
+    unsigned flags = 0;
+    long long big = 0;
+    unsigned long long bigger = 0;
+    float ratio = 0.0f;
+    double precise = 0.0;
+    bool enabled = false;
+    std::string notes;
+    int with_default = 0;
+
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        ser.attribute("name", name);
+        ser.attributes({{"count", count}, {"flags", flags}});
+        ser.child("big").text(big);
+        ser.child("bigger").text(bigger);
+        ser.child("ratio").text(ratio);
+        ser.child("precise").attribute("value", precise);
+        ser.child("enabled").text(enabled);
+        ser.child("notes").cdata(notes);
+        ser.child_with_text("with_default", with_default, 17);
+    }
+
+    bool operator==(const sample_values&) const = default;
+};
+
+TEST(TestBinary, round_trip)
+{
+    sample_values a_sample;
+    a_sample.name = "Tom & \"Jerry\"";
+    a_sample.count = -3;
+    a_sample.flags = 0xfffffff0;
+    a_sample.big = -(1ll << 40);
+    a_sample.bigger = ~0ull;
+    a_sample.ratio = 0.1f;
+    a_sample.precise = 16.1;
+    a_sample.enabled = true;
+    a_sample.notes = "a]]>b";
+    a_sample.with_default = 17;
+
+    std::string encoded;
+    {
+        pugi_serializer::binary_writer w(encoded, "sample");
+        w.set_should_write_default_values(false);
+        a_sample.serialize(w);
+    }
+
+    pugi_serializer::binary_reader r(encoded);
+    ASSERT_EQ(pugi::status_ok, r.status());
+    sample_values b_sample;
+    b_sample.serialize(r);
+    EXPECT_EQ(a_sample, b_sample);
+
+    std::string_view name_view;
+    r.attribute("name", name_view);
+    EXPECT_EQ(name_view, a_sample.name);
+}
+
+TEST(TestBinary, read_as_other_type)
+{
+    std::string encoded;
+    {
+        pugi_serializer::binary_writer w(encoded, "converted");
+        std::string number_text{"42"};
+        int number = 7;
+        w.child("string_to_int").text(number_text);
+        w.child("int_to_string").text(number);
+    }
+
+    pugi_serializer::binary_reader r(encoded);
+    int number = 0;
+    std::string number_text;
+    r.child("string_to_int").text(number);
+    r.child("int_to_string").text(number_text);
+    EXPECT_EQ(42, number);
+    EXPECT_EQ("7", number_text);
+}
+
+TEST(TestBinary, invalid_data)
+{
+    std::string encoded;
+    {
+        pugi_serializer::binary_writer w(encoded, "sample");
+        sample_values a_sample;
+        a_sample.serialize(w);
+    }
+
+    const std::string xml_text{"<sample/>"};
+    pugi_serializer::binary_reader not_binary(xml_text);
+    EXPECT_EQ(pugi::status_unrecognized_tag, not_binary.status());
+    EXPECT_FALSE(not_binary);
+
+    // every truncation should be detected
+    for (size_t size = 0; size < encoded.size(); ++size)
+    {
+        pugi_serializer::binary_reader truncated(encoded.data(), size);
+        EXPECT_NE(pugi::status_ok, truncated.status()) << "size " << size;
+    }
+}
+
+class shelf : public pugi_serializer::serialized_base
+{
+public:
+    class book : public pugi_serializer::serialized_base
+    {
+    public:
+        std::string title;
+        int pages = 0;
+        void serialize(pugi_serializer::serializer_base& ser) override
+        {
+            ser.attribute("title", title);
+            ser.attribute("pages", pages);
+        }
+        bool operator==(const book&) const = default;
+    };
+
+    std::vector<book> books_vec;
+    std::vector<book> magazines_vec;
+    std::map<std::string, book> by_title;
+
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        pugi_serializer::serialize_container(ser, books_vec, "book");
+        pugi_serializer::serialize_containers(ser, pugi_serializer::bind_container(magazines_vec, "magazine"));
+        auto index_ser = ser.child("index");
+        pugi_serializer::serialize_keyed_container(index_ser, by_title, "entry", "title");
+    }
+};
+
+TEST(TestBinary, containers)
+{
+    shelf a_shelf;
+    for (int i = 0; i < 5; ++i)
+    {
+        shelf::book a_book;
+        a_book.title = "book " + std::to_string(i);
+        a_book.pages = 100 + i;
+        a_shelf.books_vec.push_back(a_book);
+        a_shelf.by_title[a_book.title] = a_book;
+        if (i % 2 == 0)
+            a_shelf.magazines_vec.push_back(a_book);
+    }
+
+    std::string encoded;
+    {
+        pugi_serializer::binary_writer w(encoded, "shelf");
+        a_shelf.serialize(w);
+    }
+
+    // items are read through the binary reader's own elements, they are not counted in advance
+    pugi_serializer::binary_reader r(encoded);
+    ASSERT_EQ(pugi::status_ok, r.status());
+    shelf b_shelf;
+    b_shelf.serialize(r);
+    EXPECT_EQ(a_shelf.books_vec, b_shelf.books_vec);
+    EXPECT_EQ(a_shelf.magazines_vec, b_shelf.magazines_vec);
+    EXPECT_EQ(a_shelf.by_title, b_shelf.by_title);
+}
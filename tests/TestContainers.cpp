@@ -0,0 +1,200 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory_resource>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "pugi_serializer.hpp"
+
+// Tests for serializing several containers whose items are mixed siblings under the same parent
+
+class fruit : public pugi_serializer::serialized_base
+{
+public:
+    std::string name;
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        ser.attribute("name", name);
+    }
+};
+
+class basket : public pugi_serializer::serialized_base
+{
+public:
+    std::vector<fruit> apples_vec;
+    std::vector<fruit> pears_vec;
+    std::vector<fruit> plums_vec;
+
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        pugi_serializer::serialize_containers(ser,
+                                              pugi_serializer::bind_container(apples_vec, "apple"),
+                                              pugi_serializer::bind_container(pears_vec, "pear"),
+                                              pugi_serializer::bind_container(plums_vec, "plum"));
+    }
+};
+
+static std::vector<std::string> fruit_names(const std::vector<fruit>& fruits)
+{
+    std::vector<std::string> names;
+    for (auto& a_fruit : fruits)
+        names.push_back(a_fruit.name);
+    return names;
+}
+
+TEST(TestContainers, read_mixed_siblings)
+{
+    // items of different containers are interleaved, and some elements belong to no container
+    const char* xml_to_read = R"(<basket><apple name="a1"/><pear name="p1"/><grape name="g1"/><apple name="a2"/><plum name="u1"/><pear name="p2"/><apple name="a3"/></basket>)";
+    pugi::xml_document rdoc;
+    rdoc.load_string(xml_to_read);
+
+    pugi_serializer::reader r(rdoc);
+    basket b;
+    b.serialize(r);
+
+    EXPECT_EQ(fruit_names(b.apples_vec), (std::vector<std::string>{"a1", "a2", "a3"}));
+    EXPECT_EQ(fruit_names(b.pears_vec), (std::vector<std::string>{"p1", "p2"}));
+    EXPECT_EQ(fruit_names(b.plums_vec), (std::vector<std::string>{"u1"}));
+}
+
+TEST(TestContainers, write_in_binding_order)
+{
+    basket b;
+    b.apples_vec.resize(2);
+    b.apples_vec[0].name = "a1";
+    b.apples_vec[1].name = "a2";
+    b.plums_vec.resize(1);
+    b.plums_vec[0].name = "u1";
+
+    pugi::xml_document wdoc;
+    pugi_serializer::writer w(wdoc, "basket");
+    b.serialize(w);
+
+    std::ostringstream oss;
+    wdoc.save(oss, "", pugi::format_raw|pugi::format_no_declaration);
+    EXPECT_EQ(oss.str(), R"(<basket><apple name="a1"/><apple name="a2"/><plum name="u1"/></basket>)");
+}
+
+// fruits keyed by their name attribute
+class orchard : public pugi_serializer::serialized_base
+{
+public:
+    std::map<std::string, fruit> apples_map;
+    std::unordered_map<std::string, fruit> pears_map;
+    std::vector<std::pair<std::string, fruit>> plums_flat;
+
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        pugi_serializer::serialize_keyed_container(ser, apples_map, "apple", "name");
+        pugi_serializer::serialize_keyed_container(ser, pears_map, "pear", "name");
+        pugi_serializer::serialize_keyed_container(ser, plums_flat, "plum", "name");
+    }
+};
+
+TEST(TestContainers, read_keyed)
+{
+    const char* xml_to_read = R"(<orchard><apple name="a2"/><pear name="p1"/><apple name="a1"/><plum name="u3"/><plum name="u1"/><apple name="a2"/><plum name="u2"/></orchard>)";
+    pugi::xml_document rdoc;
+    rdoc.load_string(xml_to_read);
+
+    pugi_serializer::reader r(rdoc);
+    orchard o;
+    o.serialize(r);
+
+    ASSERT_EQ(o.apples_map.size(), 2u);  // duplicate a2 is read once
+    EXPECT_EQ(o.apples_map.begin()->first, "a1");
+    EXPECT_EQ(o.apples_map["a2"].name, "a2");
+    ASSERT_EQ(o.pears_map.size(), 1u);
+    EXPECT_EQ(o.pears_map["p1"].name, "p1");
+
+    ASSERT_EQ(o.plums_flat.size(), 3u);
+    EXPECT_EQ(o.plums_flat[0].first, "u1");
+    EXPECT_EQ(o.plums_flat[2].first, "u3");
+    ASSERT_NE(pugi_serializer::find_keyed(o.plums_flat, std::string("u2")), nullptr);
+    EXPECT_EQ(pugi_serializer::find_keyed(o.plums_flat, std::string("u2"))->name, "u2");
+    EXPECT_EQ(pugi_serializer::find_keyed(o.plums_flat, std::string("u4")), nullptr);
+}
+
+TEST(TestContainers, write_keyed)
+{
+    orchard o;
+    o.apples_map["a2"].name = "a2";
+    o.apples_map["a1"].name = "a1";
+    o.plums_flat.emplace_back("u1", fruit{});
+    o.plums_flat.back().second.name = "u1";
+
+    pugi::xml_document wdoc;
+    pugi_serializer::writer w(wdoc, "orchard");
+    o.serialize(w);
+
+    std::ostringstream oss;
+    wdoc.save(oss, "", pugi::format_raw|pugi::format_no_declaration);
+    EXPECT_EQ(oss.str(), R"(<orchard><apple name="a1"/><apple name="a2"/><plum name="u1"/></orchard>)");
+}
+
+// a fruit that can live in a std::pmr::memory_resource
+class pmr_fruit
+{
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    std::pmr::string name;
+    int weight = 0;
+
+    pmr_fruit() = default;
+    explicit pmr_fruit(const allocator_type& _alloc) : name(_alloc) {}
+    pmr_fruit(const pmr_fruit& other, const allocator_type& _alloc) : name(other.name, _alloc), weight(other.weight) {}
+    pmr_fruit(pmr_fruit&& other, const allocator_type& _alloc) : name(std::move(other.name), _alloc), weight(other.weight) {}
+    pmr_fruit(const pmr_fruit&) = default;
+    pmr_fruit(pmr_fruit&&) = default;
+    pmr_fruit& operator=(const pmr_fruit&) = default;
+    pmr_fruit& operator=(pmr_fruit&&) = default;
+
+    void serialize(pugi_serializer::serializer_base& ser)
+    {
+        ser.attribute("name", name);
+        ser.child("weight").text(weight);
+    }
+};
+
+TEST(TestContainers, read_into_memory_resource)
+{
+    // names longer than the small string buffer, so reading them allocates
+    const char* xml_to_read = R"(<basket><apple name="a golden apple from the orchard"><weight>150</weight></apple><apple name="a red apple from the orchard"/>)"
+                              R"(<pear name="a conference pear from the orchard"/><label>fruits of the orchard, picked today</label><label>ready to eat, keep in a cool place</label></basket>)";
+    pugi::xml_document rdoc;
+    rdoc.load_string(xml_to_read);
+
+    // nothing may be allocated outside the buffer
+    std::byte buffer[16 * 1024];
+    std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    pugi_serializer::reader r(rdoc);
+    r.set_memory_resource(&resource);
+
+    std::pmr::vector<pmr_fruit> apples(&resource);  // gives its resource to its items
+    std::vector<pmr_fruit> pears;                   // items get the reader's resource
+    std::pmr::string labels[2] = {std::pmr::string(&resource), std::pmr::string(&resource)};
+    pugi_serializer::serialize_container(r, apples, "apple");
+    pugi_serializer::serialize_container(r, pears, "pear");
+    pugi_serializer::serialize_string_array(r, labels, labels + 2, "label");
+
+    ASSERT_EQ(apples.size(), 2u);
+    EXPECT_EQ(apples[0].name, "a golden apple from the orchard");
+    EXPECT_EQ(apples[0].weight, 150);
+    EXPECT_EQ(apples[1].name, "a red apple from the orchard");
+    ASSERT_EQ(pears.size(), 1u);
+    EXPECT_EQ(pears[0].name, "a conference pear from the orchard");
+    EXPECT_EQ(labels[1], "ready to eat, keep in a cool place");
+    for (const pmr_fruit* a_fruit : {&apples[0], &apples[1], &pears[0]})
+        EXPECT_EQ(a_fruit->name.get_allocator().resource(), &resource);
+
+    pugi::xml_document wdoc;
+    pugi_serializer::writer w(wdoc, "basket");
+    pugi_serializer::serialize_container(w, pears, "pear");
+    std::ostringstream oss;
+    wdoc.save(oss, "", pugi::format_raw|pugi::format_no_declaration);
+    EXPECT_EQ(oss.str(), R"(<basket><pear name="a conference pear from the orchard"><weight>0</weight></pear></basket>)");
+}
@@ -1,4 +1,7 @@
+#include <atomic>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 
 #include "gtest/gtest.h"
 #include "pugi_serializer.hpp"
@@ -31,3 +34,245 @@ TEST(TestProperties, should_write_default_values)
     w.set_should_write_default_values(true);
     EXPECT_TRUE(w.get_should_write_default_values()) << "failed to set should_write_default_values to true";
 }
+
+TEST(TestProperties, name_token)
+{
+    using namespace pugi_serializer::literals;
+
+    constexpr pugi_serializer::name_token country_name = "country"_name;
+    static_assert(country_name.length() == 7, "name_token length should be computed at compile time");
+    static_assert(country_name.hash() == pugi_serializer::name_token::calc_hash("country", 7), "name_token hash should be computed at compile time");
+    static_assert(country_name == pugi_serializer::name_token("country"), "name_token from literal and from const char* should be equal");
+
+    EXPECT_TRUE(country_name.matches("country"));
+    EXPECT_FALSE(country_name.matches("countryside")) << "name_token should not match a longer name with the same prefix";
+    EXPECT_FALSE(country_name.matches("count")) << "name_token should not match a shorter name";
+    EXPECT_FALSE(country_name.matches("city"));
+
+    pugi::xml_document doc;
+    doc.load_string(R"(<doc><countryside/><country name="Narnia"/></doc>)");
+    pugi_serializer::reader r(doc);
+    std::string country_name_value;
+    r.child(country_name).attribute("name"_name, country_name_value);
+    EXPECT_EQ(country_name_value, "Narnia");
+}
+
+TEST(TestProperties, ordered_lookup)
+{
+    pugi::xml_document doc;
+    doc.load_string(R"(<doc><first>1</first><second>2</second><third>3</third></doc>)");
+
+    pugi_serializer::reader r(doc);
+    EXPECT_FALSE(r.get_should_use_ordered_lookup()) << "ordered lookup should be off by default";
+    r.set_should_use_ordered_lookup(true);
+
+    int first = 0, second = 0, third = 0;
+    r.child("first").text(first);
+    r.child("second").text(second);
+    r.child("third").text(third);
+    EXPECT_EQ(first + second + third, 6);
+    EXPECT_EQ(r.get_lookup_stats().cursor_hits, 3u) << "children read in document order should all be found by the cursor";
+    EXPECT_EQ(r.get_lookup_stats().cursor_misses, 0);
+
+    // out of order: falls back to searching from the first child
+    r.child("first").text(first);
+    EXPECT_EQ(first, 1);
+    EXPECT_EQ(r.get_lookup_stats().cursor_misses, 1);
+
+    r.set_should_use_ordered_lookup(false);
+    EXPECT_FALSE(r.get_should_use_ordered_lookup());
+
+    // by default, child(name) always returns the first element with that name
+    doc.load_string(R"(<doc><x a="1"/><x a="2" b="3"/></doc>)");
+    pugi_serializer::reader default_reader(doc);
+    int a = 0, b = 0;
+    default_reader.child("x").attribute("a", a);
+    default_reader.child("x").attribute("b", b, -1);
+    EXPECT_EQ(a, 1);
+    EXPECT_EQ(b, -1) << "the second child(\"x\") should return the first <x> again";
+}
+
+TEST(TestProperties, plans)
+{
+    pugi::xml_document doc;
+    doc.load_string(R"(<doc><item id="1" size="10"><name>a</name></item><item id="2" size="20"><name>b</name></item><item size="30"><name>c</name></item></doc>)");
+
+    pugi_serializer::reader r(doc);
+    EXPECT_FALSE(r.get_should_use_plans()) << "plans should be off by default";
+    r.set_should_use_plans(true);
+
+    std::string names;
+    int id_sum = 0, size_sum = 0;
+    for (auto item = r.child("item"); item; item = item.next_sibling("item"))
+    {
+        int id = 0, size = 0;
+        std::string name;
+        item.attribute("id", id);
+        item.attribute("size", size);
+        item.child("name").text(name);
+        id_sum += id;
+        size_sum += size;
+        names += name;
+    }
+    EXPECT_EQ(id_sum, 3);
+    EXPECT_EQ(size_sum, 60);
+    EXPECT_EQ(names, "abc");
+
+    // recorded by the first item, the second item follows the plan,
+    // the third item misses "id", and finds "size" one position earlier than planned
+    pugi_serializer::plan_stats stats = r.get_plan_stats();
+    EXPECT_EQ(stats.plans_recorded, 1);
+    EXPECT_EQ(stats.hits, 5);
+    EXPECT_EQ(stats.misses, 1);
+
+    // groups of children with the same name have different lengths in each item,
+    // a child is still the first with its name, so no item of a group is skipped
+    pugi::xml_document groups_doc;
+    groups_doc.load_string(R"(<doc><item><a/><b>1</b><b>2</b><b>3</b><c>1</c><c>2</c></item><item><a/><b>4</b><c>3</c><c>4</c><c>5</c></item><item><c>6</c><a/><b>5</b></item></doc>)");
+    pugi_serializer::reader groups_reader(groups_doc);
+    groups_reader.set_should_use_plans(true);
+    std::string b_values, c_values;
+    for (auto item = groups_reader.child("item"); item; item = item.next_sibling("item"))
+    {
+        item.child("a");
+        std::string first_b;
+        for (auto b = item.child("b"); b; b = b.next_sibling("b"))
+        {
+            std::string value;
+            b.text(value);
+            b_values += value;
+            if (first_b.empty())
+                first_b = value;
+        }
+        for (auto c = item.child("c"); c; c = c.next_sibling("c"))
+        {
+            std::string value;
+            c.text(value);
+            c_values += value;
+        }
+        std::string b_again;
+        item.child("b").text(b_again);
+        EXPECT_EQ(b_again, first_b) << "child(name) called again returns the first child";
+    }
+    EXPECT_EQ(b_values, "12345");
+    EXPECT_EQ(c_values, "123456");
+}
+
+TEST(TestProperties, observer)
+{
+    pugi::xml_document doc;
+    doc.load_string(R"(<doc><item id="1" size="10"><name>a</name></item><item size="30"/></doc>)");
+
+    pugi_serializer::counting_observer counter;
+    pugi_serializer::reader r(doc);
+    r.set_observer(&counter);
+    for (auto item = r.child("item"); item; item = item.next_sibling("item"))
+    {
+        int id = 0, size = 0;
+        std::string name;
+        item.attribute("id", id, -1);
+        item.attribute("size", size);
+        item.child("name").text(name);
+    }
+
+    auto attributes = counter.attributes();
+    EXPECT_EQ(attributes["id"].calls, 2);
+    EXPECT_EQ(attributes["id"].misses, 1);
+    EXPECT_EQ(attributes["id"].defaults, 1);
+    EXPECT_EQ(attributes["size"].scanned, 3) << "2nd of 2 attributes, then 1st of 1";
+
+    // "item" is found by child() and next_sibling(), which finally finds nothing
+    auto elements = counter.elements();
+    EXPECT_EQ(elements["item"].calls, 3);
+    EXPECT_EQ(elements["item"].misses, 1);
+    EXPECT_EQ(elements["name"].bytes_copied, 1);
+
+    pugi::xml_document write_doc;
+    pugi_serializer::writer w(write_doc, "doc");
+    w.set_should_write_default_values(false);
+    counter.reset();
+    w.set_observer(&counter);
+    int id = -1, size = 30;
+    std::string name = "abc";
+    auto item = w.child("item");
+    item.attribute("id", id, -1);
+    item.attribute("size", size);
+    item.child("name").text(name);
+
+    EXPECT_EQ(counter.attributes()["id"].defaults, 1) << "default value should not be written";
+    EXPECT_EQ(counter.elements()["name"].bytes_copied, 3);
+    EXPECT_EQ(counter.total().calls, 5);
+}
+
+TEST(TestProperties, session)
+{
+    // no pugixml memory is allocated between tests, so the functions can be installed here
+    pugi_serializer::session::install_memory_functions();
+    pugi_serializer::session a_session(64 * 1024);
+    size_t capacity = 0;
+    for (int message = 0; message < 10; ++message)
+    {
+        std::string xml = "<doc><item id=\"" + std::to_string(message) + "\"><name>item " + std::to_string(message) + "</name></item></doc>";
+        ASSERT_EQ(pugi::status_ok, a_session.load_string(xml.c_str()).status);
+        EXPECT_GT(a_session.arena_used(), 0u) << "the document should be allocated from the arena";
+
+        int id = -1;
+        std::string name;
+        {
+            pugi_serializer::reader r(a_session);
+            EXPECT_FALSE(r.get_should_use_from_chars()) << "settings of the previous reader should not be kept";
+            r.set_should_use_from_chars(true);
+            auto item = r.child("item");
+            item.attribute("id", id);
+            item.child("name").text(name);
+        }
+        EXPECT_EQ(id, message);
+        EXPECT_EQ(name, "item " + std::to_string(message));
+
+        {
+            pugi_serializer::writer w(a_session, "doc");     // resets the document that was read
+            EXPECT_FALSE(w.get_should_use_to_chars()) << "settings of the previous writer should not be kept";
+            w.set_should_use_to_chars(true);
+            auto item = w.child("item");
+            item.attribute("id", id);
+            const size_t used = a_session.arena_used();
+            {
+                pugi::xml_document other_doc;
+                other_doc.append_child("other").text().set(name.c_str());
+            }
+            EXPECT_EQ(a_session.arena_used(), used) << "a document built while writing should not use the arena";
+            item.child("name").text(name);
+        }
+        std::ostringstream written;
+        a_session.document().save(written, "", pugi::format_raw | pugi::format_no_declaration);
+        EXPECT_EQ(written.str(), xml);
+
+        // the arena grows for the first message only
+        if (0 == message)
+            capacity = a_session.arena_capacity();
+        EXPECT_EQ(a_session.arena_capacity(), capacity);
+    }
+
+    // a document that is not a session's is allocated and freed as usual
+    pugi::xml_document doc;
+    doc.load_string("<doc><item/></doc>");
+    EXPECT_EQ(a_session.arena_capacity(), capacity);
+}
+
+TEST(TestProperties, parallel_for_exception)
+{
+    pugi_serializer::thread_pool pool(4);
+    std::atomic<size_t> num_calls{0};
+    EXPECT_THROW(pool.parallel_for(100, [&](const size_t i)
+    {
+        ++num_calls;
+        if (7 == i)
+            throw std::runtime_error("task failed");
+    }), std::runtime_error);
+    EXPECT_LE(num_calls.load(), 100u);
+
+    // the pool is still usable after a task threw
+    num_calls = 0;
+    pool.parallel_for(100, [&](const size_t) { ++num_calls; });
+    EXPECT_EQ(num_calls.load(), 100u);
+}
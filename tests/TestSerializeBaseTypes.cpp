@@ -115,3 +115,143 @@ TYPED_TEST(TestSerializeBoolTypes, bool_base_type)
     EXPECT_EQ(this->write_to_text, this->read_from_text);
     EXPECT_EQ(this->write_to_attrib, this->read_from_attrib);
 }
+
+// test std::string_view, values are read as views into the document
+TEST(TestSerializeStringView, string_view_read_write)
+{
+    std::string_view write_to_text = "Lisbon";
+    std::string_view write_to_attrib = "Portugal";
+    std::string_view read_from_text;
+    std::string_view read_from_attrib;
+    std::string_view read_missing = "not changed";
+
+    auto pdoc = std::make_shared<pugi::xml_document>();
+    {
+        pugi_serializer::writer w(*pdoc, "TestSerializeStringView");
+        auto write_node = w.child("value");
+        write_node.text(write_to_text);
+        write_node.attribute("attrib", write_to_attrib);
+    }
+
+    std::shared_ptr<pugi::xml_document> kept_doc;
+    {
+        pugi_serializer::reader r(pdoc);
+        auto read_node = r.child("value");
+        read_node.text(read_from_text);
+        read_node.attribute("attrib", read_from_attrib);
+        read_node.attribute("missing", read_missing);
+        kept_doc = r.document();
+    }
+    pdoc.reset();  // views are still valid, kept_doc owns the document
+
+    EXPECT_EQ(write_to_text, read_from_text);
+    EXPECT_EQ(write_to_attrib, read_from_attrib);
+    EXPECT_EQ(std::string_view("not changed"), read_missing);
+    auto value_node = kept_doc->document_element().child("value");
+    EXPECT_EQ(value_node.text().as_string(), read_from_text.data());
+    EXPECT_EQ(value_node.attribute("attrib").value(), read_from_attrib.data());
+}
+
+// test reading numbers with std::from_chars, and the recording of numbers that could not be parsed
+TEST(TestSerializeFromChars, from_chars_read)
+{
+    pugi::xml_document pdoc;
+    pdoc.load_string("<numbers>"
+                     "<good int=\" -17 \" hex=\"0x1F\" plus=\"+5\" float=\"1.5e3\" double=\"-0.125\" llong=\"-9000000000\" ullong=\"18000000000000000000\"/>"
+                     "<bad int=\"12abc\" uint=\"4294967296\" float=\"one\" empty=\"\">2,5</bad>"
+                     "</numbers>");
+
+    pugi_serializer::reader r(pdoc);
+    r.set_should_use_from_chars(true);
+    EXPECT_TRUE(r.get_should_use_from_chars());
+
+    int good_int = 0, good_hex = 0, good_plus = 0;
+    float good_float = 0;
+    double good_double = 0;
+    long long good_llong = 0;
+    unsigned long long good_ullong = 0;
+    auto good = r.child("good");
+    good.attribute("int", good_int);
+    good.attribute("hex", good_hex);
+    good.attribute("plus", good_plus);
+    good.attribute("float", good_float);
+    good.attribute("double", good_double);
+    good.attribute("llong", good_llong);
+    good.attribute("ullong", good_ullong);
+    EXPECT_EQ(-17, good_int);
+    EXPECT_EQ(31, good_hex);
+    EXPECT_EQ(5, good_plus);
+    EXPECT_EQ(1500.0f, good_float);
+    EXPECT_EQ(-0.125, good_double);
+    EXPECT_EQ(-9000000000LL, good_llong);
+    EXPECT_EQ(18000000000000000000ULL, good_ullong);
+    EXPECT_TRUE(r.get_parse_errors().empty());
+
+    int bad_int = 1, bad_empty = 1;
+    unsigned bad_uint = 1;
+    float bad_float = 1, bad_text = 1;
+    auto bad = r.child("bad");
+    bad.attribute("int", bad_int);
+    bad.attribute("uint", bad_uint);
+    bad.attribute("float", bad_float);
+    bad.attribute("empty", bad_empty);
+    bad.text(bad_text);
+    EXPECT_EQ(0, bad_int);
+    EXPECT_EQ(0u, bad_uint);
+    EXPECT_EQ(0.0f, bad_float);
+    EXPECT_EQ(0, bad_empty);
+    EXPECT_EQ(0.0f, bad_text);
+
+    const auto& errors = r.get_parse_errors();
+    ASSERT_EQ(4u, errors.size());
+    EXPECT_STREQ("int", errors[0].name);
+    EXPECT_STREQ("12abc", errors[0].text);
+    EXPECT_EQ(std::errc::invalid_argument, errors[0].error);
+    EXPECT_STREQ("uint", errors[1].name);
+    EXPECT_EQ(std::errc::result_out_of_range, errors[1].error);
+    EXPECT_STREQ("float", errors[2].name);
+    EXPECT_EQ(std::errc::invalid_argument, errors[2].error);
+    EXPECT_STREQ("bad", errors[3].name);
+    EXPECT_STREQ("2,5", errors[3].text);
+}
+
+// test writing numbers with std::to_chars, floating point numbers are written in shortest round trip form
+TEST(TestSerializeToChars, to_chars_write)
+{
+    double d = 0.1;
+    double whole = 16.0;
+    float f = 1.1f;
+    int i = -42;
+    unsigned long long ull = 18000000000000000000ULL;
+    bool b = true;
+
+    pugi::xml_document pdoc;
+    {
+        pugi_serializer::writer w(pdoc, "TestSerializeToChars");
+        w.set_should_use_to_chars(true);
+        EXPECT_TRUE(w.get_should_use_to_chars());
+        w.child("double").text(d);
+        w.child("whole").text(whole);
+        auto numbers = w.child("numbers");
+        numbers.attribute("float", f);
+        numbers.attribute("int", i);
+        numbers.attribute("ullong", ull);
+        numbers.attribute("bool", b);
+    }
+
+    auto root = pdoc.document_element();
+    EXPECT_STREQ("0.1", root.child("double").text().as_string());
+    EXPECT_STREQ("16", root.child("whole").text().as_string());
+    EXPECT_STREQ("1.1", root.child("numbers").attribute("float").value());
+    EXPECT_STREQ("-42", root.child("numbers").attribute("int").value());
+    EXPECT_STREQ("18000000000000000000", root.child("numbers").attribute("ullong").value());
+    EXPECT_STREQ("true", root.child("numbers").attribute("bool").value());
+
+    double read_d = 0;
+    float read_f = 0;
+    pugi_serializer::reader r(pdoc);
+    r.child("double").text(read_d);
+    r.child("numbers").attribute("float", read_f);
+    EXPECT_EQ(d, read_d);
+    EXPECT_EQ(f, read_f);
+}
@@ -92,3 +92,56 @@ TEST(TestSerializeDefaults, ValuesWithDefault)
         EXPECT_EQ(values_to_read, values_to_write);
     }
 }
+
+struct batch_values
+{
+    std::string name;
+    int count = -1;
+    double weight = -1.0;
+    bool active = false;
+    unsigned missing_no_default = 7;
+    float missing_with_default = -1.0f;
+};
+
+static void serialize_attributes_batch(pugi_serializer::serializer_base ser, batch_values& values)
+{
+    ser.child("Noddy").attributes({
+        {"name", values.name, "Noddy"},
+        {"count", values.count},
+        {"weight", values.weight, 0.0},
+        {"active", values.active},
+        {"missing_no_default", values.missing_no_default},
+        {"missing_with_default", values.missing_with_default, 2.5f}});
+}
+
+TEST(TestSerializeDefaults, AttributesBatch)
+{
+    {
+        // attributes in different order than the bindings, some attributes missing
+        pugi::xml_document pdoc;
+        pdoc.load_string(R"(<AttributesBatch><Noddy active="true" count="3" weight="1.5"/></AttributesBatch>)");
+
+        pugi_serializer::reader r(pdoc);
+        batch_values values_to_read;
+        serialize_attributes_batch(r, values_to_read);
+
+        EXPECT_EQ(values_to_read.name, "Noddy") << "missing attribute with default should get the default";
+        EXPECT_EQ(values_to_read.count, 3);
+        EXPECT_EQ(values_to_read.weight, 1.5);
+        EXPECT_TRUE(values_to_read.active);
+        EXPECT_EQ(values_to_read.missing_no_default, 7) << "missing attribute without default should remain unchanged";
+        EXPECT_EQ(values_to_read.missing_with_default, 2.5f);
+    }
+    {
+        // writing appends attributes in the order of the bindings, skipping defaults
+        pugi::xml_document pdoc;
+        pugi_serializer::writer w(pdoc, "AttributesBatch");
+        w.set_should_write_default_values(false);
+        batch_values values_to_write{"Noddy", 3, 1.5, true, 7, 2.5f};
+        serialize_attributes_batch(w, values_to_write);
+
+        std::ostringstream oss;
+        pdoc.save(oss, "", pugi::format_raw|pugi::format_no_declaration);
+        EXPECT_STREQ(oss.str().c_str(), R"(<AttributesBatch><Noddy count="3" weight="1.5" active="true" missing_no_default="7"/></AttributesBatch>)");
+    }
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pugi_serializer.hpp"
+
+// Tests for reading the children of the root one at a time with stream_reader
+
+class plant : public pugi_serializer::serialized_base
+{
+public:
+    std::string name;
+    int height = 0;
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        ser.attribute("name", name);
+        ser.child("height").text(height);
+    }
+};
+
+static const char* garden_xml = R"(<?xml version="1.0"?>
+<!-- a comment with a > in it -->
+<garden owner="Ann">
+    <tree name="oak"><height>20</height></tree>
+    <flower name="rose"><height>1</height><!-- </flower> --></flower>
+    <tree name="pine"><height>30</height><![CDATA[</tree>]]></tree>
+    <bench/>
+</garden>
+)";
+
+TEST(TestStreamReader, for_each_item)
+{
+    std::istringstream in(garden_xml);
+    pugi_serializer::stream_reader sr(in);
+    ASSERT_EQ(pugi::status_ok, sr.status());
+    EXPECT_STREQ("garden", sr.root().name());
+    EXPECT_STREQ("Ann", sr.root().attribute("owner").value());
+
+    std::vector<std::string> names;
+    size_t num_items = sr.for_each_item([&](pugi_serializer::serializer_base& item_ser)
+    {
+        names.push_back(item_ser.node_name());
+    });
+    EXPECT_EQ(4u, num_items);
+    EXPECT_EQ(names, (std::vector<std::string>{"tree", "flower", "tree", "bench"}));
+    EXPECT_EQ(pugi::status_ok, sr.status());
+}
+
+TEST(TestStreamReader, serialize_each)
+{
+    std::vector<std::string> tree_names;
+    int total_height = 0;
+    auto on_tree = [&](plant& _tree)
+    {
+        tree_names.push_back(_tree.name);
+        total_height += _tree.height;
+    };
+
+    pugi_serializer::stream_reader sr(garden_xml, std::strlen(garden_xml));
+    EXPECT_EQ(2u, pugi_serializer::serialize_each<plant>(sr, "tree", on_tree));
+    EXPECT_EQ(tree_names, (std::vector<std::string>{"oak", "pine"}));
+    EXPECT_EQ(50, total_height);
+
+    // same with a document
+    tree_names.clear();
+    total_height = 0;
+    pugi::xml_document doc;
+    doc.load_string(garden_xml);
+    pugi_serializer::reader r(doc);
+    EXPECT_EQ(2u, pugi_serializer::serialize_each<plant>(r, "tree", on_tree));
+    EXPECT_EQ(tree_names, (std::vector<std::string>{"oak", "pine"}));
+    EXPECT_EQ(50, total_height);
+}
+
+TEST(TestStreamReader, truncated)
+{
+    const char* truncated_xml = "<garden><tree name=\"oak\"><height>20</height></tree><tree name=\"pine\"><height>";
+    pugi_serializer::stream_reader sr(truncated_xml, std::strlen(truncated_xml));
+    EXPECT_TRUE(bool(sr.next_item()));
+    EXPECT_FALSE(bool(sr.next_item()));
+    EXPECT_NE(pugi::status_ok, sr.status());
+}
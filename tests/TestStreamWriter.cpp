@@ -0,0 +1,113 @@
+#include <iostream>
+#include <sstream>
+#include <functional>
+
+#include "gtest/gtest.h"
+#include "pugi_serializer.hpp"
+
+// Tests that stream_writer writes the same xml as writer followed by xml_document::save
+
+// a serialize function that exercises text before/after attributes, escaping, empty elements and cdata
+static void serialize_sample(pugi_serializer::serializer_base ser)
+{
+    std::string name{"Tom & \"Jerry\""};
+    std::string nick{"<cat>"};
+    int age = 83;
+    double weight = 16.1;
+    bool cartoon = true;
+    std::string empty;
+    std::string notes{"a]]>b"};
+
+    auto name_ser = ser.child("name");
+    name_ser.text(name);
+    name_ser.attribute("nickname", nick);
+    ser.child("age").text(age);
+    auto details = ser.child("details");
+    details.attribute("weight", weight);
+    details.attribute("cartoon", cartoon);
+    details.child("empty");
+    details.child("empty_text").text(empty);
+    details.child("notes").cdata(notes);
+    ser.child_with_text("skipped", age, 83);
+}
+
+static std::string write_with_dom(const char* _indent, unsigned int _flags)
+{
+    pugi::xml_document doc;
+    {
+        pugi_serializer::writer w(doc, "sample");
+        w.set_should_write_default_values(false);
+        serialize_sample(w);
+    }
+    std::ostringstream oss;
+    doc.save(oss, _indent, _flags);
+    return oss.str();
+}
+
+static std::string write_with_stream(const char* _indent, unsigned int _flags)
+{
+    std::string out;
+    {
+        pugi_serializer::stream_writer w(out, "sample", _indent, _flags);
+        w.set_should_write_default_values(false);
+        serialize_sample(w);
+        EXPECT_EQ(0u, w.get_out_of_order_count());
+    }
+    return out;
+}
+
+TEST(TestStreamWriter, same_as_dom_indented)
+{
+    EXPECT_EQ(write_with_dom("\t", pugi::format_default), write_with_stream("\t", pugi::format_default));
+    EXPECT_EQ(write_with_dom("  ", pugi::format_default), write_with_stream("  ", pugi::format_default));
+}
+
+TEST(TestStreamWriter, same_as_dom_raw)
+{
+    EXPECT_EQ(write_with_dom("", pugi::format_raw), write_with_stream("", pugi::format_raw));
+    EXPECT_EQ(write_with_dom("", pugi::format_raw | pugi::format_no_declaration), write_with_stream("", pugi::format_raw | pugi::format_no_declaration));
+    EXPECT_EQ(write_with_dom("\t", pugi::format_indent | pugi::format_no_empty_element_tags), write_with_stream("\t", pugi::format_indent | pugi::format_no_empty_element_tags));
+}
+
+TEST(TestStreamWriter, ostream_output)
+{
+    std::ostringstream oss;
+    {
+        pugi_serializer::stream_writer w(oss, "sample");
+        serialize_sample(w);
+        w.finish();
+        EXPECT_EQ(write_with_dom("\t", pugi::format_default).size(), oss.str().size()) << "finish() should write everything to the stream";
+    }
+}
+
+TEST(TestStreamWriter, late_attribute)
+{
+    std::string out;
+    std::string value{"v"};
+    pugi_serializer::stream_writer w(out, "root", "", pugi::format_raw | pugi::format_no_declaration);
+    auto first = w.child("first");
+    first.attribute("early", value);
+    first.child("inner");
+    first.attribute("late", value);     // inserted into the start tag, which is still in the output
+    w.finish();
+
+    EXPECT_EQ(0u, w.get_out_of_order_count());
+    EXPECT_EQ(out, "<root><first early=\"v\" late=\"v\"><inner/></first></root>");
+}
+
+TEST(TestStreamWriter, out_of_order)
+{
+    std::string out;
+    std::string value{"v"};
+    pugi_serializer::stream_writer w(out, "root", "", pugi::format_raw | pugi::format_no_declaration);
+    auto first = w.child("first");
+    first.child("inner").text(value);
+    auto second = w.child("second");
+    first.text(value);                  // <first> was closed by <second>
+    first.attribute("late", value);     // same
+    second.child("inner");
+    w.finish();
+
+    EXPECT_EQ(2u, w.get_out_of_order_count());
+    EXPECT_EQ(out, "<root><first><inner>v</inner></first><second><inner/></second></root>");
+}
@@ -0,0 +1,122 @@
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pugi_serializer.hpp"
+
+// Tests that update_writer changes only what differs between the document and what is written
+
+class task : public pugi_serializer::serialized_base
+{
+public:
+    int id = 0;
+    std::string title;
+    double hours = 0;
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        ser.attribute("id", id);
+        ser.child("title").text(title);
+        ser.child_with_text("hours", hours, 0.0);
+    }
+};
+
+class todo_list : public pugi_serializer::serialized_base
+{
+public:
+    std::string owner;
+    std::vector<task> tasks;
+    void serialize(pugi_serializer::serializer_base& ser) override
+    {
+        ser.attribute("owner", owner);
+        pugi_serializer::serialize_container(ser, tasks, "task");
+    }
+};
+
+static const char* todo_xml = R"(<todo owner="Ann"><!-- kept --><task id="1"><title>shop</title><hours>1.5</hours></task><task id="2"><title>cook</title></task></todo>)";
+
+static std::string to_string(const pugi::xml_document& doc)
+{
+    std::ostringstream oss;
+    doc.save(oss, "", pugi::format_raw | pugi::format_no_declaration);
+    return oss.str();
+}
+
+static todo_list read_todo(pugi::xml_document& doc)
+{
+    todo_list todo;
+    pugi_serializer::reader r(doc);
+    todo.serialize(r);
+    return todo;
+}
+
+static pugi_serializer::update_stats update_todo(pugi::xml_document& doc, todo_list& todo)
+{
+    pugi_serializer::update_writer w(doc, "todo");
+    w.set_should_write_default_values(false);
+    todo.serialize(w);
+    w.finish();
+    return w.get_update_stats();
+}
+
+TEST(TestUpdateWriter, unchanged)
+{
+    pugi::xml_document doc;
+    ASSERT_EQ(pugi::status_ok, doc.load_string(todo_xml, pugi::parse_default | pugi::parse_comments).status);
+    todo_list todo = read_todo(doc);
+
+    EXPECT_EQ(update_todo(doc, todo).touched(), 0u) << "writing what was read should not change the document";
+    EXPECT_EQ(to_string(doc), todo_xml);
+}
+
+TEST(TestUpdateWriter, changed_values)
+{
+    pugi::xml_document doc;
+    ASSERT_EQ(pugi::status_ok, doc.load_string(todo_xml, pugi::parse_default | pugi::parse_comments).status);
+    todo_list todo = read_todo(doc);
+    todo.tasks[1].title = "bake";
+
+    pugi_serializer::update_stats stats = update_todo(doc, todo);
+    EXPECT_EQ(stats.values_changed, 1u);
+    EXPECT_EQ(stats.touched(), 1u);
+    EXPECT_EQ(to_string(doc), R"(<todo owner="Ann"><!-- kept --><task id="1"><title>shop</title><hours>1.5</hours></task><task id="2"><title>bake</title></task></todo>)");
+}
+
+TEST(TestUpdateWriter, changed_structure)
+{
+    pugi::xml_document doc;
+    ASSERT_EQ(pugi::status_ok, doc.load_string(todo_xml, pugi::parse_default | pugi::parse_comments).status);
+    todo_list todo = read_todo(doc);
+
+    // the first task loses its hours, which is a default value, a third task is added
+    todo.tasks[0].hours = 0;
+    todo.tasks.push_back(todo.tasks[1]);
+    todo.tasks[2].id = 3;
+    pugi_serializer::update_stats stats = update_todo(doc, todo);
+    EXPECT_EQ(stats.nodes_removed, 1u);
+    EXPECT_EQ(stats.nodes_added, 2u) << "task and its title";
+    EXPECT_EQ(stats.attributes_added, 1u);
+    EXPECT_EQ(to_string(doc), R"(<todo owner="Ann"><!-- kept --><task id="1"><title>shop</title></task><task id="2"><title>cook</title></task><task id="3"><title>cook</title></task></todo>)");
+
+    // the remaining tasks are written into the first elements, the last element is removed
+    todo.tasks.erase(todo.tasks.begin());
+    todo.owner.clear();
+    stats = update_todo(doc, todo);
+    EXPECT_EQ(stats.nodes_removed, 1u);
+    EXPECT_EQ(stats.values_changed, 4u) << "owner, ids of the tasks that moved up, and the title that differs";
+    EXPECT_EQ(to_string(doc), R"(<todo owner=""><!-- kept --><task id="2"><title>cook</title></task><task id="3"><title>cook</title></task></todo>)");
+}
+
+TEST(TestUpdateWriter, empty_document)
+{
+    pugi::xml_document doc;
+    todo_list todo;
+    todo.owner = "Bob";
+    todo.tasks.resize(1);
+    todo.tasks[0].title = "rest";
+
+    pugi_serializer::update_stats stats = update_todo(doc, todo);
+    EXPECT_EQ(stats.nodes_added, 3u) << "todo, task and title";
+    EXPECT_EQ(stats.attributes_added, 2u);
+    EXPECT_EQ(to_string(doc), R"(<todo owner="Bob"><task id="0"><title>rest</title></task></todo>)");
+    EXPECT_EQ(update_todo(doc, todo).touched(), 0u);
+}
@@ -0,0 +1,369 @@
+// generator of synthetic mondial documents of any size, for benchmarks and scaling tests,
+// so that large files do not have to be kept in git.
+// the generated world uses the classes of mondial_model.hpp, and is written with pugi_serializer::writer.
+// the same options and seed always generate the same document, on all platforms.
+
+#ifndef __MONDIAL_GENERATOR_HPP__
+#define __MONDIAL_GENERATOR_HPP__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pugi_serializer.hpp"
+#include "mondial_model.hpp"
+
+struct generator_options
+{
+    uint64_t seed = 1;
+    size_t target_bytes = 1024 * 1024;      // approximate size of the xml text, countries are added until it's reached
+    unsigned provinces_per_country = 8;     // mean fan-out, each count is between 0 and twice the mean
+    unsigned cities_per_province = 6;
+    unsigned cities_per_country = 2;        // cities that are direct children of the country
+    unsigned groups_per_country = 3;        // ethnicgroups, religions and languages, each
+    unsigned borders_per_country = 4;
+    unsigned features_per_country = 3;      // mountains, deserts, islands, rivers, seas and lakes
+    unsigned members_per_organization = 20;
+    double attribute_fill = 0.8;            // probability that an optional value is set, unset optional values are not written
+};
+
+namespace mondial_generator_impl
+{
+    // splitmix64: small, fast, and gives the same sequence everywhere, unlike the std distributions
+    class random
+    {
+    public:
+        explicit random(uint64_t _seed) : m_state(_seed) {}
+
+        uint64_t next()
+        {
+            uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        // uniform in [0, 1)
+        double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+        double uniform(double _min, double _max) { return _min + (_max - _min) * uniform(); }
+        unsigned below(unsigned _bound) { return 0 == _bound ? 0 : static_cast<unsigned>(next() % _bound); }
+        bool chance(double _probability) { return uniform() < _probability; }
+
+        // a count between 0 and twice the mean
+        unsigned fan_out(unsigned _mean) { return below(2 * _mean + 1); }
+
+        // pareto distribution: many small values and a few very large ones, like populations and areas
+        double pareto(double _min, double _alpha) { return _min / std::pow(1.0 - uniform(), 1.0 / _alpha); }
+
+        // rounded to _decimals digits after the point, as numbers usually appear in data files
+        double rounded(double _val, int _decimals)
+        {
+            const double scale = std::pow(10.0, _decimals);
+            return std::round(_val * scale) / scale;
+        }
+
+    private:
+        uint64_t m_state;
+    };
+
+    class world_builder
+    {
+    public:
+        explicit world_builder(const generator_options& _options)
+        : m_options(_options)
+        , m_random(_options.seed)
+        {}
+
+        world build()
+        {
+            world w;
+            static const char* continent_names[] = {"Europe", "Asia", "America", "Australia/Oceania", "Africa"};
+            for (const char* continent_name : continent_names)
+            {
+                continent a_continent;
+                a_continent.id = next_id();
+                a_continent.name = continent_name;
+                w.continent_vec.push_back(a_continent);
+            }
+
+            // countries are added until the estimated size is reached,
+            // the size of each is measured by writing it to a string
+            size_t total_bytes = 0;
+            std::string scratch;
+            while (total_bytes < m_options.target_bytes)
+            {
+                w.country_vec.push_back(make_country(w));
+                scratch.clear();
+                {
+                    pugi_serializer::stream_writer country_writer(scratch, "country");
+                    country_writer.set_should_write_default_values(false);
+                    w.country_vec.back().serialize(static_cast<pugi_serializer::serializer_base&>(country_writer));
+                }
+                total_bytes += scratch.size();
+
+                if (0 == w.country_vec.size() % 20)
+                    total_bytes += add_organization(w);
+                for (unsigned i = m_random.fan_out(m_options.features_per_country); i > 0; --i)
+                    total_bytes += add_feature(w);
+            }
+            return w;
+        }
+
+    private:
+        std::string next_id() { return "f0_" + std::to_string(m_next_id++); }
+
+        // pronounceable name of 2 to 4 syllables
+        std::string make_name()
+        {
+            static const char* syllables[] = {"ba", "ri", "to", "ka", "len", "mor", "sa", "vi", "du", "an", "el", "go",
+                                              "ne", "pol", "ta", "ur", "zi", "mar", "che", "lo", "ha", "bro", "dan", "ix"};
+            constexpr unsigned num_syllables = sizeof(syllables) / sizeof(syllables[0]);
+            std::string name;
+            for (unsigned i = 2 + m_random.below(3); i > 0; --i)
+                name += syllables[m_random.below(num_syllables)];
+            name[0] = static_cast<char>(name[0] - 'a' + 'A');
+            return name;
+        }
+
+        // unique upper case code for each country: A..Z, AA..ZZ, ...
+        static std::string make_car_code(size_t _index)
+        {
+            std::string code;
+            do
+            {
+                code.insert(code.begin(), static_cast<char>('A' + _index % 26));
+                _index /= 26;
+            } while (_index-- > 0);
+            return code;
+        }
+
+        std::string optional_name()
+        {
+            return m_random.chance(m_options.attribute_fill) ? make_name() : std::string();
+        }
+
+        city make_city(const std::string& _car_code)
+        {
+            city a_city;
+            a_city.id = next_id();
+            a_city.name = optional_name();
+            a_city.country = _car_code;
+            a_city.longitude = m_random.rounded(m_random.uniform(-180.0, 180.0), 2);
+            a_city.latitude = m_random.rounded(m_random.uniform(-90.0, 90.0), 2);
+            if (m_random.chance(m_options.attribute_fill))
+            {
+                a_city.population = static_cast<unsigned>(std::min(m_random.pareto(5000.0, 1.2), 4.0e9));
+                a_city.population_year = 1950 + static_cast<int>(m_random.below(50));
+            }
+            return a_city;
+        }
+
+        province make_province(const std::string& _car_code, const std::string& _country_id)
+        {
+            province a_province;
+            a_province.id = next_id();
+            a_province.name = make_name();
+            a_province.country = _country_id;
+            for (unsigned i = m_random.fan_out(m_options.cities_per_province); i > 0; --i)
+                a_province.cities_vec.push_back(make_city(_car_code));
+            if (!a_province.cities_vec.empty())
+                a_province.capital = a_province.cities_vec[m_random.below(static_cast<unsigned>(a_province.cities_vec.size()))].id;
+            a_province.population = static_cast<unsigned>(std::min(m_random.pareto(50000.0, 1.1), 4.0e9));
+            a_province.area = static_cast<unsigned>(std::min(m_random.pareto(500.0, 0.9), 4.0e9));
+            return a_province;
+        }
+
+        // percentages of a group of _count values that add up to 100
+        std::vector<percentage_value> make_percentages(unsigned _count)
+        {
+            std::vector<percentage_value> values(_count);
+            double remaining = 100.0;
+            for (percentage_value& value : values)
+            {
+                value.name = make_name();
+                value.percentage = m_random.rounded(remaining * m_random.uniform(0.3, 0.9), 1);
+                remaining -= value.percentage;
+            }
+            return values;
+        }
+
+        country make_country(const world& _world)
+        {
+            country a_country;
+            a_country.id = next_id();
+            a_country.car_code = make_car_code(_world.country_vec.size());
+            a_country.name = make_name();
+            a_country.name_text = a_country.name;
+            a_country.datacode = a_country.car_code;
+            a_country.population = static_cast<int>(std::min(m_random.pareto(100000.0, 0.8), 2.0e9));
+            a_country.total_area = static_cast<int>(std::min(m_random.pareto(1000.0, 0.7), 2.0e9));
+            a_country.population_growth = m_random.rounded(m_random.uniform(-2.0, 5.0), 2);
+            a_country.infant_mortality = m_random.rounded(m_random.uniform(2.0, 150.0), 2);
+            a_country.gdp_agri = m_random.rounded(m_random.uniform(0.0, 60.0), 1);
+            a_country.gdp_total = static_cast<int>(std::min(m_random.pareto(1000.0, 0.9), 2.0e9));
+            if (m_random.chance(m_options.attribute_fill))
+                a_country.inflation = m_random.rounded(m_random.pareto(1.0, 1.5), 1);
+            if (m_random.chance(m_options.attribute_fill))
+                a_country.indep_date = std::to_string(1800 + m_random.below(200)) + "-0" + std::to_string(1 + m_random.below(9)) + "-1" + std::to_string(m_random.below(10));
+            a_country.government = m_random.chance(0.5) ? "republic" : "constitutional monarchy";
+
+            for (unsigned i = m_random.fan_out(m_options.provinces_per_country); i > 0; --i)
+                a_country.provinces_vec.push_back(make_province(a_country.car_code, a_country.id));
+            for (unsigned i = m_random.fan_out(m_options.cities_per_country); i > 0; --i)
+                a_country.cities_vec.push_back(make_city(a_country.car_code));
+            if (!a_country.cities_vec.empty())
+                a_country.capital = pugi_serializer::ref<city>(a_country.cities_vec.front().id);
+            else if (!a_country.provinces_vec.empty())
+                a_country.capital = pugi_serializer::ref<city>(a_country.provinces_vec.front().capital);
+
+            a_country.ethnicgroups_vec = make_percentages(m_random.fan_out(m_options.groups_per_country));
+            a_country.religions_vec = make_percentages(m_random.fan_out(m_options.groups_per_country));
+            a_country.languages_vec = make_percentages(m_random.fan_out(m_options.groups_per_country));
+
+            encompassed an_encompassed;
+            an_encompassed.continent = _world.continent_vec[m_random.below(static_cast<unsigned>(_world.continent_vec.size()))].id;
+            an_encompassed.percentage = 100.0f;
+            a_country.encompassed_vec.push_back(an_encompassed);
+
+            if (!_world.country_vec.empty())
+            {
+                for (unsigned i = m_random.fan_out(m_options.borders_per_country); i > 0; --i)
+                {
+                    border a_border;
+                    a_border.country = pugi_serializer::ref<country>(_world.country_vec[m_random.below(static_cast<unsigned>(_world.country_vec.size()))].id);
+                    a_border.length = m_random.rounded(m_random.pareto(10.0, 0.8), 1);
+                    a_country.borders_vec.push_back(a_border);
+                }
+            }
+            return a_country;
+        }
+
+        // approximate size of what's added, a rough estimate is enough since countries are most of the document
+        size_t add_organization(world& _world)
+        {
+            organization an_organization;
+            an_organization.id = next_id();
+            an_organization.name = make_name() + " Organization";
+            an_organization.abbrev = make_car_code(_world.organization_vec.size() + 26 * 26);
+            if (m_random.chance(m_options.attribute_fill))
+                an_organization.established = std::to_string(1900 + m_random.below(100));
+            if (m_random.chance(m_options.attribute_fill))
+                an_organization.headq = _world.country_vec[m_random.below(static_cast<unsigned>(_world.country_vec.size()))].capital.id();
+            for (unsigned i = m_random.fan_out(m_options.members_per_organization); i > 0; --i)
+            {
+                organization::member a_member;
+                a_member.type = m_random.chance(0.8) ? "member" : "observer";
+                a_member.country = _world.country_vec[m_random.below(static_cast<unsigned>(_world.country_vec.size()))].car_code;
+                an_organization.members_vec.push_back(a_member);
+            }
+            const size_t num_bytes = 120 + 40 * an_organization.members_vec.size();
+            _world.organization_vec.push_back(std::move(an_organization));
+            return num_bytes;
+        }
+
+        located make_located(const world& _world)
+        {
+            const country& a_country = _world.country_vec[m_random.below(static_cast<unsigned>(_world.country_vec.size()))];
+            located a_located;
+            a_located.country = a_country.car_code;
+            if (!a_country.provinces_vec.empty())
+                a_located.province = a_country.provinces_vec[m_random.below(static_cast<unsigned>(a_country.provinces_vec.size()))].id;
+            return a_located;
+        }
+
+        size_t add_feature(world& _world)
+        {
+            const unsigned num_locations = 1 + m_random.below(3);
+            switch (m_random.below(6))
+            {
+                case 0:
+                {
+                    mountain a_mountain;
+                    a_mountain.id = next_id();
+                    a_mountain.name = make_name();
+                    a_mountain.longitude = m_random.rounded(m_random.uniform(-180.0, 180.0), 2);
+                    a_mountain.latitude = m_random.rounded(m_random.uniform(-90.0, 90.0), 2);
+                    a_mountain.height = static_cast<uint64_t>(m_random.uniform(200.0, 8848.0));
+                    for (unsigned i = 0; i < num_locations; ++i)
+                        a_mountain.locations_vec.push_back(make_located(_world));
+                    _world.mountain_vec.push_back(std::move(a_mountain));
+                    return 140 + 40 * num_locations;
+                }
+                case 1:
+                {
+                    desert a_desert;
+                    a_desert.id = next_id();
+                    a_desert.name = make_name();
+                    a_desert.area = static_cast<uint64_t>(m_random.pareto(100.0, 0.8));
+                    _world.desert_vec.push_back(std::move(a_desert));
+                    return 60;
+                }
+                case 2:
+                {
+                    island an_island;
+                    an_island.id = next_id();
+                    an_island.name = make_name();
+                    an_island.area = static_cast<uint64_t>(m_random.pareto(1.0, 0.6));
+                    _world.island_vec.push_back(std::move(an_island));
+                    return 60;
+                }
+                case 3:
+                {
+                    river a_river;
+                    a_river.id = next_id();
+                    a_river.name = make_name();
+                    a_river.to_type = m_random.chance(0.7) ? "sea" : "river";
+                    a_river.to_water = next_id();
+                    _world.river_vec.push_back(std::move(a_river));
+                    return 90;
+                }
+                case 4:
+                {
+                    sea a_sea;
+                    a_sea.id = next_id();
+                    a_sea.name = make_name() + " Sea";
+                    a_sea.depth = static_cast<uint64_t>(m_random.uniform(50.0, 11000.0));
+                    for (unsigned i = 0; i < num_locations; ++i)
+                        a_sea.locations_vec.push_back(make_located(_world));
+                    _world.sea_vec.push_back(std::move(a_sea));
+                    return 70 + 40 * num_locations;
+                }
+                default:
+                {
+                    lake a_lake;
+                    a_lake.id = next_id();
+                    a_lake.name = "Lake " + make_name();
+                    if (m_random.chance(m_options.attribute_fill))
+                        a_lake.area = m_random.rounded(m_random.pareto(1.0, 0.7), 1);
+                    for (unsigned i = 0; i < num_locations; ++i)
+                        a_lake.locations_vec.push_back(make_located(_world));
+                    _world.lake_vec.push_back(std::move(a_lake));
+                    return 70 + 40 * num_locations;
+                }
+            }
+        }
+
+        const generator_options m_options;
+        random m_random;
+        size_t m_next_id = 1;
+    };
+}
+
+// generate a world whose xml is about _options.target_bytes
+inline world generate_world(const generator_options& _options)
+{
+    return mondial_generator_impl::world_builder(_options).build();
+}
+
+// generate a world and write it to _doc, unset optional values are not written
+inline void generate_document(const generator_options& _options, pugi::xml_document& _doc)
+{
+    world w = generate_world(_options);
+    pugi_serializer::writer writer_serializer(_doc, "mondial");
+    writer_serializer.set_should_write_default_values(false);
+    w.serialize(writer_serializer);
+}
+
+#endif // __MONDIAL_GENERATOR_HPP__
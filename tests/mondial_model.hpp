@@ -0,0 +1,451 @@
+// mondial object model, used by the tests and benchmarks of the mondial-3.0.xml file
+// each class has a template serialize function that can be used with pugi_serializer::serializer_base
+// and with pugi_serializer::basic_serializer, and a serialized_base::serialize override that calls it
+
+#ifndef __MONDIAL_MODEL_HPP__
+#define __MONDIAL_MODEL_HPP__
+
+#include <string>
+#include <vector>
+#include <compare>
+
+#include "pugi_serializer.hpp"
+
+inline auto operator<=>(const std::string& lhs, const std::string& rhs)
+{
+    // apple clang 21.6.0: no support for std::string::operator<=> (8-<)
+    int comp_res = lhs.compare(rhs);
+    if (0 > comp_res) return std::strong_ordering::less;
+    else if (0 < comp_res) return std::strong_ordering::greater;
+    else return std::strong_ordering::equal;
+}
+
+class encompassed : public pugi_serializer::serialized_base
+{
+public:
+    friend auto operator<=>(const encompassed&, const encompassed&) = default;
+    friend bool operator==(const encompassed&, const encompassed&) = default;
+
+    std::string continent;
+    float percentage;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        ser.attribute("continent", continent);
+        ser.attribute("percentage", percentage);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class country;
+
+class border : public pugi_serializer::serialized_base
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const border&, const border&) = default;
+#endif
+    pugi_serializer::ref<::country> country;
+    float length;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        pugi_serializer::serialize_ref(ser, "country", country);
+        ser.attribute("length", length);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+// entity has an is and a name
+class entity : public pugi_serializer::serialized_base
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const entity&, const entity&) = default;
+#endif
+
+    std::string id;
+    std::string name;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        ser.attribute("id", id);
+        ser.attribute("name", name, "");
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class coordinates : public pugi_serializer::serialized_base
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const coordinates&, const coordinates&) = default;
+#endif
+    float longitude = 0.0;
+    float latitude = 0.0;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        ser.attribute("longitude", longitude);
+        ser.attribute("latitude", latitude);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+
+};
+
+class continent : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const continent&, const continent&) = default;
+#endif
+};
+
+class percentage_value : public pugi_serializer::serialized_base
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const percentage_value&, const percentage_value&) = default;
+#endif
+    std::string name;
+    float percentage = 0.0;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        ser.attribute("percentage", percentage);
+        ser.text(name);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class city : public entity, public coordinates
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const city&, const city&) = default;
+#endif
+    std::string country;
+    int population_year = 0;
+    unsigned int population = 0;
+
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        // city has it's name as element text, not as attribute so cannot call
+        //entity::serialize(ser);
+        
+        pugi_serializer::serialize_id(ser, "id", id, *this);
+        ser.child_with_text("name", name, "");
+
+        ser.attribute("country", country);
+        
+        coordinates::serialize(ser);
+        
+        auto population_ser = ser.child_with_text("population", population, (unsigned int)0);
+        // note that when wrtting and set_should_write_default_values(false),
+        // attrib "year" will only be written if population!=0
+        population_ser.attribute("year", population_year);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class province : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const province&, const province&) = default;
+#endif
+    std::string country;
+    std::string capital;
+    unsigned int population = 0;
+    unsigned int area = 0;
+    std::vector<city> cities_vec;
+
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        ser.attribute("country", country);
+        ser.attribute("capital", capital);
+        ser.attribute("population", population);
+        ser.attribute("area", area);
+
+        pugi_serializer::serialize_container_parallel(ser, cities_vec, "city");
+
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class country : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const country&, const country&) = default;
+#endif
+    std::string name_text;
+    pugi_serializer::ref<city> capital;
+    int population = 0;
+    std::string datacode;
+    int total_area = 0;
+    double population_growth = 0.0;
+    double infant_mortality = 0.0;
+    double gdp_agri = 0.0;
+    int gdp_total = 0;
+    float inflation = 0.0;
+    std::string indep_date;
+    std::string government;
+    std::string car_code;
+    
+    std::vector<city>             cities_vec;
+    std::vector<province>         provinces_vec;
+    std::vector<percentage_value> ethnicgroups_vec;
+    std::vector<percentage_value> religions_vec;
+    std::vector<percentage_value> languages_vec;
+    std::vector<encompassed>      encompassed_vec;
+    std::vector<border>           borders_vec;
+
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        // the id and capital are indexed when reading with an id_index, the other attributes are serialized in one batch
+        pugi_serializer::serialize_id(ser, "id", id, *this);
+        ser.attribute("name", name, "");
+        pugi_serializer::serialize_ref(ser, "capital", capital);
+        ser.attributes({
+            {"population", population},
+            {"total_area", total_area},
+            {"population_growth", population_growth},
+            {"infant_mortality", infant_mortality},
+            {"gdp_agri", gdp_agri},
+            {"gdp_total", gdp_total},
+            {"inflation", inflation, 0.0f},
+            {"indep_date", indep_date, ""},
+            {"government", government},
+            {"car_code", car_code}});
+        
+        ser.child("name").text(name_text);
+
+        pugi_serializer::serialize_containers(ser,
+                                              pugi_serializer::bind_container(cities_vec, "city"),
+                                              pugi_serializer::bind_container(provinces_vec, "province"),
+                                              pugi_serializer::bind_container(ethnicgroups_vec, "ethnicgroups"),
+                                              pugi_serializer::bind_container(religions_vec, "religions"),
+                                              pugi_serializer::bind_container(languages_vec, "languages"),
+                                              pugi_serializer::bind_container(encompassed_vec, "encompassed"),
+                                              pugi_serializer::bind_container(borders_vec, "border"));
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class organization : public entity
+{
+public:
+    friend auto operator<=>(const organization&, const organization&) = default;
+
+    std::string abbrev;
+    std::string established;
+    std::string headq;
+    
+    class member : public pugi_serializer::serialized_base
+    {
+    public:
+        std::string type;
+        std::string country;
+        template<typename TSERIALIZER>
+        void serialize(TSERIALIZER& ser)
+        {
+            ser.attribute("type", type);
+            ser.attribute("country", country);
+        }
+        void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+    };
+    std::vector<member> members_vec;
+    
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        ser.attribute("abbrev", abbrev);
+        ser.attribute("established", established, "");
+        ser.attribute("headq", headq, "");
+
+        pugi_serializer::serialize_container(ser, members_vec, "members");
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class located : public pugi_serializer::serialized_base
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const located&, const located&) = default;
+#endif
+    //std::vector<std::pair<std::string, std::string>> locations;
+    std::string country;
+    std::string province;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        ser.attribute("country", country);
+        ser.attribute("province", province);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class feature : public entity, public coordinates
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const feature&, const feature&) = default;
+#endif
+    std::vector<located> locations_vec;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        coordinates::serialize(ser);
+        pugi_serializer::serialize_container(ser, locations_vec, "located");
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class mountain : public feature
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const mountain&, const mountain&) = default;
+#endif
+    uint64_t height = 0;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        feature::serialize(ser);
+        ser.attribute("height", height);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class desert : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const desert&, const desert&) = default;
+#endif
+    uint64_t area = 0;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        ser.attribute("area", area);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class river : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const river&, const river&) = default;
+#endif
+    std::string to_type;
+    std::string to_water;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        
+        auto to_node = ser.child("to");
+        to_node.attribute("type", to_type);
+        to_node.attribute("water", to_water);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class island : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const island&, const island&) = default;
+#endif
+    uint64_t area = 0;
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        ser.attribute("area", area);
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class sea : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const sea&, const sea&) = default;
+#endif
+    uint64_t depth = 0;
+    std::vector<located> locations_vec;
+
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        ser.attribute("depth", depth);
+        pugi_serializer::serialize_container(ser, locations_vec, "located");
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class lake : public entity
+{
+public:
+#if (__cplusplus == 202002L)  // c++20
+    friend auto operator<=>(const lake&, const lake&) = default;
+#endif
+    float area = 0.0f;
+    std::vector<located> locations_vec;
+
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        entity::serialize(ser);
+        ser.attribute("area", area, 0.0f);
+        pugi_serializer::serialize_container(ser, locations_vec, "located");
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+class world : public pugi_serializer::serialized_base
+{
+public:
+    friend auto operator<=>(const world&, const world&) = default;
+
+    std::vector<continent> continent_vec;
+    std::vector<country> country_vec;
+    std::vector<organization> organization_vec;
+    std::vector<mountain> mountain_vec;
+    std::vector<desert> desert_vec;
+    std::vector<island> island_vec;
+    std::vector<river> river_vec;
+    std::vector<sea> sea_vec;
+    std::vector<lake> lake_vec;
+    
+
+    template<typename TSERIALIZER>
+    void serialize(TSERIALIZER& ser)
+    {
+        pugi_serializer::serialize_containers(ser,
+                                              pugi_serializer::bind_container(continent_vec, "continent"),
+                                              pugi_serializer::bind_container(country_vec, "country"),
+                                              pugi_serializer::bind_container(organization_vec, "organization"),
+                                              pugi_serializer::bind_container(mountain_vec, "mountain"),
+                                              pugi_serializer::bind_container(desert_vec, "desert"),
+                                              pugi_serializer::bind_container(island_vec, "island"),
+                                              pugi_serializer::bind_container(river_vec, "river"),
+                                              pugi_serializer::bind_container(sea_vec, "sea"),
+                                              pugi_serializer::bind_container(lake_vec, "lake"));
+    }
+    void serialize(pugi_serializer::serializer_base& ser) override { serialize<pugi_serializer::serializer_base>(ser); }
+};
+
+#endif // __MONDIAL_MODEL_HPP__